@@ -1,5 +1,6 @@
 
 #include "Angel.h"
+#include "program_cache.hpp"
 
 namespace Angel {
 
@@ -37,8 +38,6 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	{ fShaderFile, GL_FRAGMENT_SHADER, NULL }
     };
 
-    GLuint program = glCreateProgram();
-    
     for ( int i = 0; i < 2; ++i ) {
 	Shader& s = shaders[i];
 	s.source = readShaderSource( s.filename );
@@ -46,6 +45,22 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	    std::cerr << "Failed to read " << s.filename << std::endl;
 	    exit( EXIT_FAILURE );
 	}
+    }
+
+	// Reuse the linked program of an earlier run if the sources are unchanged
+    std::string key = programCacheKey( shaders[0].source, shaders[1].source, "" );
+    GLuint program = loadCachedProgram( key );
+    if ( program != 0 ) {
+	delete [] shaders[0].source;
+	delete [] shaders[1].source;
+	glUseProgram(program);
+	return program;
+    }
+
+    program = glCreateProgram();
+    
+    for ( int i = 0; i < 2; ++i ) {
+	Shader& s = shaders[i];
 
 	GLuint shader = glCreateShader( s.type );
 	glShaderSource( shader, 1, (const GLchar**) &s.source, NULL );
@@ -71,6 +86,7 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
     }
 
 	// Error and link check
+    prepareProgramForCache(program);
     glLinkProgram(program);
 
     GLint  linked;
@@ -87,6 +103,8 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	exit( EXIT_FAILURE );
     }
 
+    storeCachedProgram(program, key);
+
 	//Use *program*
     glUseProgram(program);
 
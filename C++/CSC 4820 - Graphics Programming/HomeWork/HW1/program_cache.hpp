@@ -0,0 +1,203 @@
+/* This is a utility program that stores linked shader programs on disk, so that the GLSL
+compiler only runs the first time a program is used.
+The following functions are provided.
+
+// Build the cache key of a program from the exact source text passed to glShaderSource()
+// (GLSL has no #include, so this is the complete preprocessor input), any other state that
+// is baked into the program at link time (e.g. glBindAttribLocation calls), and the
+// GL_VENDOR, GL_RENDERER and GL_VERSION strings of the current context.
+std::string programCacheKey(const char *vertexSource, const char *fragmentSource, const char *linkState);
+
+// Create a program from the cached binary. Returns 0 if there is no usable binary, e.g. the
+// sources changed, the driver was updated, or GL_ARB_get_program_binary is not supported.
+GLuint loadCachedProgram(const std::string &key);
+
+// Call before glLinkProgram() on a program that will be stored.
+void prepareProgramForCache(GLuint program);
+
+// Save the binary of a successfully linked program.
+bool storeCachedProgram(GLuint program, const std::string &key);
+
+Typical use:
+
+	std::string key = programCacheKey(vShader, fShader, "");
+	GLuint program = loadCachedProgram(key);
+	if (program == 0) {
+		program = glCreateProgram();
+		... compile and attach the shaders ...
+		prepareProgramForCache(program);
+		glLinkProgram(program);
+		storeCachedProgram(program, key);
+	}
+
+A changed source gives a different key, so stale binaries are never loaded; they are
+simply left in the cache directory. The files are written to PROGRAM_CACHE_DIRECTORY
+in the working directory.
+
+On Mac OS X, Angel.h uses the system OpenGL headers without GLEW, so there are no program
+binaries: loadCachedProgram() always returns 0 and every program is linked.
+
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#define PROGRAM_CACHE_DIRECTORY "shader_cache"
+
+// Identifies a program cache file; followed by the binary format and length.
+const unsigned int PROGRAM_CACHE_MAGIC = 0x31435047; // "GPC1"
+
+//------------------------------------------------
+// 64-bit FNV-1a hash, continued from the given hash value.
+unsigned long long hashProgramText(const char *text, unsigned long long hash) {
+	if (text == NULL) {
+		text = "";
+	}
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+		hash ^= *p;
+		hash *= 1099511628211ULL;
+	}
+	// Hash a separator so that "ab" + "c" and "a" + "bc" give different keys.
+	hash ^= 0xff;
+	hash *= 1099511628211ULL;
+	return hash;
+}
+
+//------------------------------------------------
+std::string programCacheKey(const char *vertexSource, const char *fragmentSource, const char *linkState) {
+	unsigned long long hash = 14695981039346656037ULL;
+
+	hash = hashProgramText(vertexSource, hash);
+	hash = hashProgramText(fragmentSource, hash);
+	hash = hashProgramText(linkState, hash);
+	hash = hashProgramText((const char *)glGetString(GL_VENDOR), hash);
+	hash = hashProgramText((const char *)glGetString(GL_RENDERER), hash);
+	hash = hashProgramText((const char *)glGetString(GL_VERSION), hash);
+
+	char key[17];
+	sprintf(key, "%016llx", hash);
+	return std::string(key);
+}
+
+#ifdef __APPLE__
+
+GLuint loadCachedProgram(const std::string &key) {
+	return 0;
+}
+
+void prepareProgramForCache(GLuint program) {
+}
+
+bool storeCachedProgram(GLuint program, const std::string &key) {
+	return false;
+}
+
+#else // non-Mac OS X operating systems
+
+//------------------------------------------------
+// True if the driver can return program binaries in at least one format.
+bool programBinarySupported() {
+	if (!GLEW_ARB_get_program_binary) {
+		return false;
+	}
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+std::string programCacheFilename(const std::string &key) {
+	return std::string(PROGRAM_CACHE_DIRECTORY) + "/" + key + ".bin";
+}
+
+//------------------------------------------------
+GLuint loadCachedProgram(const std::string &key) {
+	if (!programBinarySupported()) {
+		return 0;
+	}
+
+	std::ifstream file(programCacheFilename(key).c_str(), std::ios::binary);
+	if (!file.is_open()) {
+		return 0;
+	}
+
+	unsigned int header[3] = {0, 0, 0}; // magic, binary format, length
+	file.read((char *)header, sizeof(header));
+	if (!file || header[0] != PROGRAM_CACHE_MAGIC || header[2] == 0) {
+		return 0;
+	}
+
+	std::vector<char> binary(header[2]);
+	file.read(&binary[0], header[2]);
+	if (!file) {
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, (GLenum)header[1], &binary[0], (GLsizei)header[2]);
+
+	// The driver rejects binaries it cannot use, e.g. after a driver update.
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+//------------------------------------------------
+void prepareProgramForCache(GLuint program) {
+	if (programBinarySupported()) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+//------------------------------------------------
+bool storeCachedProgram(GLuint program, const std::string &key) {
+	if (!programBinarySupported()) {
+		return false;
+	}
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (!linked || length <= 0) {
+		return false;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, &binary[0]);
+
+#ifdef _WIN32
+	_mkdir(PROGRAM_CACHE_DIRECTORY);
+#else
+	mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+#endif
+
+	std::ofstream file(programCacheFilename(key).c_str(), std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "Cannot write the program cache file " << programCacheFilename(key) << std::endl;
+		return false;
+	}
+
+	unsigned int header[3] = { PROGRAM_CACHE_MAGIC, (unsigned int)format, (unsigned int)length };
+	file.write((const char *)header, sizeof(header));
+	file.write(&binary[0], length);
+
+	return file.good();
+}
+
+#endif // __APPLE__
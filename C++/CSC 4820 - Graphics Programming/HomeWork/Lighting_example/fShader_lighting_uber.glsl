@@ -0,0 +1,138 @@
+#version 330
+
+// This fragment shader replaces fShader_point_light_phong.glsl, fShader_point_light_blinn.glsl,
+// fShader_lighting_cartoon1.glsl and fShader_lighting_cartoon2.glsl. The C++ program inserts
+// #define lines after the #version line to select one variant (see shader_permutation.hpp):
+//
+// LIGHTING_MODEL  0: Phong, 1: Blinn, 2: cartoon with two colors, 3: cartoon with four bands
+// SPOTLIGHT       0: point light, 1: spotlight (spotDirection and spotCutoff)
+
+#define LIGHTING_PHONG 0
+#define LIGHTING_BLINN 1
+#define LIGHTING_CARTOON1 2
+#define LIGHTING_CARTOON2 3
+
+#ifndef LIGHTING_MODEL
+#define LIGHTING_MODEL LIGHTING_BLINN
+#endif
+
+#ifndef SPOTLIGHT
+#define SPOTLIGHT 0
+#endif
+
+in vec3 N; // interpolated normal for the pixel
+in vec3 v; // interpolated position for the pixel
+
+// Uniform block for the light source properties
+layout (std140) uniform LightSourceProp {
+	// Light source position in eye space (i.e. eye is at (0, 0, 0))
+	uniform vec4 lightSourcePosition;
+
+	uniform vec4 diffuseLightIntensity;
+	uniform vec4 specularLightIntensity;
+	uniform vec4 ambientLightIntensity;
+
+	// for calculating the light attenuation
+	uniform float constantAttenuation;
+	uniform float linearAttenuation;
+	uniform float quadraticAttenuation;
+
+	// Spotlight direction
+	uniform vec3 spotDirection;
+
+	// Spotlight cutoff angle
+	uniform float spotCutoff;
+};
+
+// Uniform block for surface material properties
+layout (std140) uniform materialProp {
+	uniform vec4 Kambient;
+	uniform vec4 Kdiffuse;
+	uniform vec4 Kspecular;
+	uniform float shininess;
+};
+
+out vec4 color;
+
+void main() {
+
+    // point light source
+    vec3 lightVector = normalize(lightSourcePosition.xyz - v);
+
+    vec3 eyeVector = normalize(-v); // Eye vector. We are in Eye Coordinates, so EyePos is (0,0,0)
+
+    // This is the cosine of the angle between the normal vector and the light vector.
+    float NdotL = max(dot(N,lightVector), 0.0);
+
+#if SPOTLIGHT
+    // Only the pixels inside the cone around spotDirection are lit. The light gets
+    // weaker towards the edge of the cone.
+    float spotEffect = dot(normalize(spotDirection), -lightVector);
+    float spotAttenuation = spotEffect >= cos(spotCutoff) ? spotEffect : 0.0;
+#else
+    float spotAttenuation = 1.0;
+#endif
+
+#if LIGHTING_MODEL == LIGHTING_PHONG || LIGHTING_MODEL == LIGHTING_BLINN
+    // color = Ka * La + attenuation * ((Kd * (N dot L) * Ld) + (Ks * (specular term ^ shininess) * Ls))
+    // Ka, Kd, Ks: surface material properties
+    // La, Ld, Ls: ambient, diffuse, and specular components of the light source
+    // attenuation: light intensity attenuation over distance and spotlight angle
+
+    // calculate light attenuation
+    float distance = length(lightSourcePosition.xyz - v);
+    float attenuation = spotAttenuation / (constantAttenuation + (linearAttenuation * distance)
+		+(quadraticAttenuation * distance * distance));
+
+    //calculate Diffuse Color
+    vec4 diffuseColor = Kdiffuse * diffuseLightIntensity * NdotL;
+
+  #if LIGHTING_MODEL == LIGHTING_PHONG
+    // The original Phong illumination model
+    vec3 R = normalize(-reflect(lightVector,N)); // light reflection vector
+    float specularTerm = max(dot(R,eyeVector),0.0);
+  #else
+    // The Blinn & Torrance variation
+    vec3 halfVector = (lightVector + eyeVector) / 2;
+    float specularTerm = max(dot(N,halfVector),0.0);
+  #endif
+
+    vec4 specularColor = Kspecular * specularLightIntensity * pow(specularTerm,shininess);
+
+    // ambient color
+    vec4 ambientColor = Kambient * ambientLightIntensity;
+
+    color = ambientColor + attenuation * (diffuseColor + specularColor);
+
+#elif LIGHTING_MODEL == LIGHTING_CARTOON1
+    float Kd = NdotL * spotAttenuation;
+
+    // Paint the pixel red or yellow depending on the angle of the incoming light.
+    color = Kd > 0.6 ? vec4(1.0, 1.0, 0.0, 1.0) : vec4(1.0, 0.0, 0.0, 1.0);
+
+    // If the angle between the eye vector and the normal is too big, paint the pixel
+    // black. This pixel is likely on the silhouette.
+    if (abs(dot(eyeVector, N)) < 0.15) {
+       color = vec4(0.0, 0.0, 0.0, 1.0);
+    }
+
+#elif LIGHTING_MODEL == LIGHTING_CARTOON2
+    float Kd = NdotL * spotAttenuation;
+
+    // Paint the pixel is different colors based on the angle of incoming light.
+    if (Kd > 0.95) {
+        color = vec4(1.0, 0.5, 0.5, 1.0);
+    } else if (Kd > 0.5) {
+        color = vec4(0.6, 0.3, 0.3, 1.0);
+    } else if (Kd > 0.25) {
+        color = vec4(0.4, 0.2, 0.2, 1.0);
+    } else {
+        color = vec4(0.1, 0.1, 0.1, 1.0);
+    }
+
+    color = color + vec4(0.2, 0.2, 0.2, 1.0);
+
+#else
+  #error Unknown LIGHTING_MODEL
+#endif
+}
@@ -0,0 +1,231 @@
+/* This is a utility program that builds variants (permutations) of one uber-shader by
+inserting #define lines after the #version line of its sources.
+The following class and struct are provided.
+
+// One #define that selects a variant, e.g. ShaderDefine("LIGHTING_MODEL", 1).
+struct ShaderDefine;
+
+class ShaderPermutationCache {
+	// Read the uber-shader sources. Returns false if a file cannot be read.
+	bool loadSources(const char* vertexFilename, const char* fragmentFilename);
+
+	// Give an attribute the same location in every permutation, so that one VAO
+	// can be drawn with any of them. Call before the first program() call.
+	void bindAttribute(const char* name, GLuint location);
+
+	// The program of the permutation selected by the defines. It is compiled the first
+	// time it is asked for and cached by its defines. Returns 0 if it does not compile;
+	// the compiler output is printed with printShaderInfoLog().
+	GLuint program(const vector<ShaderDefine>& defines);
+
+	// Number of permutations compiled so far.
+	unsigned int programCount();
+
+	// Delete every program.
+	void release();
+};
+
+The shader code selects its variant with #if on the defines, so a permutation only contains
+the code it needs; nothing is decided at run time. A #line directive follows the defines,
+so the line numbers in compiler errors still match the source file.
+
+If program_cache.hpp is included before this file, the linked permutations are also stored
+in the on-disk program cache.
+
+Include check_error.hpp before this file.
+
+*/
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+struct ShaderDefine {
+	ShaderDefine(const string& defineName, int defineValue) : name(defineName), value(defineValue) {}
+
+	string name;
+	int value;
+};
+
+class ShaderPermutationCache {
+public:
+	ShaderPermutationCache() {}
+
+	~ShaderPermutationCache() { release(); }
+
+	ShaderPermutationCache(const ShaderPermutationCache&) = delete;
+	ShaderPermutationCache& operator=(const ShaderPermutationCache&) = delete;
+
+	//------------------------------------------------
+	bool loadSources(const char* vertexFilename, const char* fragmentFilename) {
+		release();
+		return readFile(vertexFilename, vertexSource) && readFile(fragmentFilename, fragmentSource);
+	}
+
+	//------------------------------------------------
+	void bindAttribute(const char* name, GLuint location) {
+		attributes.push_back(make_pair(string(name), location));
+	}
+
+	//------------------------------------------------
+	GLuint program(const vector<ShaderDefine>& defines) {
+		string defineBlock;
+		stringstream permutationName;
+		for (unsigned int i = 0; i < defines.size(); i++) {
+			stringstream line;
+			line << "#define " << defines[i].name << " " << defines[i].value << "\n";
+			defineBlock += line.str();
+			permutationName << (i > 0 ? " " : "") << defines[i].name << "=" << defines[i].value;
+		}
+
+		// Programs that failed to compile are cached as 0, so they are not compiled every frame.
+		map<string, GLuint>::iterator found = programs.find(defineBlock);
+		if (found != programs.end()) {
+			return found->second;
+		}
+
+		GLuint programID = compileProgram(defineBlock, permutationName.str());
+		programs[defineBlock] = programID;
+		return programID;
+	}
+
+	//------------------------------------------------
+	unsigned int programCount() {
+		return (unsigned int)programs.size();
+	}
+
+	//------------------------------------------------
+	void release() {
+		for (map<string, GLuint>::iterator i = programs.begin(); i != programs.end(); ++i) {
+			if (i->second != 0) {
+				glDeleteProgram(i->second);
+			}
+		}
+		programs.clear();
+	}
+
+private:
+	//------------------------------------------------
+	// Split a source into its #version line and the rest. The #version line must stay first.
+	static void splitVersion(const string& source, string& versionLine, string& body) {
+		size_t start = source.find_first_not_of(" \t\r\n");
+		if (start != string::npos && source.compare(start, 8, "#version") == 0) {
+			size_t end = source.find('\n', start);
+			end = (end == string::npos) ? source.size() : end + 1;
+			versionLine = source.substr(0, end);
+			body = source.substr(end);
+		} else {
+			versionLine = "";
+			body = source;
+		}
+	}
+
+	//------------------------------------------------
+	// Insert the defines after the #version line, followed by a #line directive that
+	// restores the line numbers of the source file.
+	static string permutationSource(const string& source, const string& defineBlock) {
+		string versionLine, body;
+		splitVersion(source, versionLine, body);
+
+		int bodyLine = 1;
+		for (unsigned int i = 0; i < versionLine.size(); i++) {
+			if (versionLine[i] == '\n') {
+				bodyLine++;
+			}
+		}
+
+		stringstream lineDirective;
+		lineDirective << "#line " << bodyLine << "\n";
+		return versionLine + defineBlock + lineDirective.str() + body;
+	}
+
+	//------------------------------------------------
+	GLuint compileProgram(const string& defineBlock, const string& permutationName) {
+		string vShaderSource = permutationSource(vertexSource, defineBlock);
+		string fShaderSource = permutationSource(fragmentSource, defineBlock);
+		const char* vShader = vShaderSource.c_str();
+		const char* fShader = fShaderSource.c_str();
+
+#ifdef PROGRAM_CACHE_DIRECTORY
+		// The attribute bindings are baked into the program, so they are part of the key.
+		string linkState;
+		for (unsigned int i = 0; i < attributes.size(); i++) {
+			stringstream binding;
+			binding << attributes[i].first << "=" << attributes[i].second << " ";
+			linkState += binding.str();
+		}
+		string programKey = programCacheKey(vShader, fShader, linkState.c_str());
+		GLuint cachedProgramID = loadCachedProgram(programKey);
+		if (cachedProgramID != 0) {
+			cout << "Shader permutation " << permutationName << " loaded from the program cache" << endl;
+			return cachedProgramID;
+		}
+#endif
+
+		cout << "Compiling shader permutation " << permutationName << endl;
+
+		GLuint vShaderID = glCreateShader(GL_VERTEX_SHADER);
+		GLuint fShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(vShaderID, 1, &vShader, NULL);
+		glShaderSource(fShaderID, 1, &fShader, NULL);
+
+		glCompileShader(vShaderID);
+		printShaderInfoLog(vShaderID); // Print error messages, if any.
+		glCompileShader(fShaderID);
+		printShaderInfoLog(fShaderID); // Print error messages, if any.
+
+		GLuint programID = glCreateProgram();
+		glAttachShader(programID, vShaderID);
+		glAttachShader(programID, fShaderID);
+		for (unsigned int i = 0; i < attributes.size(); i++) {
+			glBindAttribLocation(programID, attributes[i].second, attributes[i].first.c_str());
+		}
+
+#ifdef PROGRAM_CACHE_DIRECTORY
+		prepareProgramForCache(programID);
+#endif
+		glLinkProgram(programID);
+		printShaderProgramInfoLog(programID); // Print error messages, if any.
+
+		// The shaders are released together with the program.
+		glDeleteShader(vShaderID);
+		glDeleteShader(fShaderID);
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			cout << "Shader permutation " << permutationName << " failed to compile" << endl;
+			glDeleteProgram(programID);
+			return 0;
+		}
+
+#ifdef PROGRAM_CACHE_DIRECTORY
+		storeCachedProgram(programID, programKey);
+#endif
+		return programID;
+	}
+
+	//------------------------------------------------
+	static bool readFile(const char* filename, string& contents) {
+		ifstream file(filename);
+		if (!file.is_open()) {
+			cout << "Cannot open the shader file " << filename << endl;
+			return false;
+		}
+		stringstream buffer;
+		buffer << file.rdbuf();
+		contents = buffer.str();
+		return true;
+	}
+
+	string vertexSource;
+	string fragmentSource;
+	vector<pair<string, GLuint> > attributes;
+	map<string, GLuint> programs; // by the #define lines of the permutation
+};
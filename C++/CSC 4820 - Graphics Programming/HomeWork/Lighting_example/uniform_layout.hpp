@@ -0,0 +1,236 @@
+/* This is a utility program that checks the C++ structs uploaded to uniform buffers against
+the layout of the GLSL uniform blocks they fill. The layout is queried from the linked program
+(GL_UNIFORM_OFFSET, GL_UNIFORM_BLOCK_DATA_SIZE), so std140 padding mistakes are reported at
+startup instead of showing up as wrong lighting.
+The following struct and functions are provided.
+
+// One member of the C++ struct: the name of the matching member in the GLSL block and the
+// offset of the C++ member, e.g. { "spotDirection", offsetof(LightSourceProp, spotDirection) }
+struct UniformBlockField {
+	const char* name;
+	size_t offset;
+};
+
+// Compare the C++ struct with the uniform block of a linked program. Every block member must
+// have a field at the same offset, every field must be a block member, and the struct must
+// be at least as large as the block. Mismatches are printed together with a C++ struct
+// generated from the block layout, and false is returned. A program without the block
+// passes, since there is nothing to check.
+bool validateUniformBlock(GLuint programID, const char* blockName, const char* structName,
+	size_t structSize, const UniformBlockField* fields, size_t fieldCount);
+
+// The layout of a uniform block, and the C++ struct that matches it.
+bool reflectUniformBlock(GLuint programID, const char* blockName, GLint& dataSize,
+	std::vector<UniformBlockMember>& members);
+std::string uniformBlockStruct(const char* structName, GLint dataSize, const std::vector<UniformBlockMember>& members);
+
+Example:
+	const UniformBlockField materialFields[] = {
+		{ "Kambient", offsetof(SurfaceMaterialProp, Kambient) },
+		...
+	};
+	if (!validateUniformBlock(programID, "materialProp", "SurfaceMaterialProp", sizeof(SurfaceMaterialProp),
+		materialFields, sizeof(materialFields) / sizeof(materialFields[0]))) {
+		exit(EXIT_FAILURE);
+	}
+
+*/
+
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct UniformBlockField {
+	const char* name; // member name in the GLSL block
+	size_t offset; // offsetof() the C++ member
+};
+
+// A member of a uniform block, as reported by the linked program
+struct UniformBlockMember {
+	std::string name; // without the "[0]" of arrays
+	GLint offset;
+	GLenum type;
+	GLint arraySize; // 1 if the member is not an array
+	GLint arrayStride; // bytes between array elements (0 if not an array)
+	GLint matrixStride; // bytes between matrix columns (0 if not a matrix)
+};
+
+//---------------------------------------------------------
+// Query the layout of a uniform block. Returns false if the program has no such block.
+// The members are sorted by offset.
+bool reflectUniformBlock(GLuint programID, const char* blockName, GLint& dataSize,
+	std::vector<UniformBlockMember>& members) {
+	members.clear();
+	GLuint blockIndex = glGetUniformBlockIndex(programID, blockName);
+	if (blockIndex == GL_INVALID_INDEX) {
+		return false;
+	}
+
+	GLint memberCount = 0;
+	glGetActiveUniformBlockiv(programID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+	glGetActiveUniformBlockiv(programID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+	if (memberCount <= 0) {
+		return true;
+	}
+
+	std::vector<GLint> indices(memberCount);
+	glGetActiveUniformBlockiv(programID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, &indices[0]);
+	std::vector<GLuint> uniformIndices(indices.begin(), indices.end());
+
+	std::vector<GLint> offsets(memberCount), types(memberCount), sizes(memberCount);
+	std::vector<GLint> arrayStrides(memberCount), matrixStrides(memberCount);
+	glGetActiveUniformsiv(programID, memberCount, &uniformIndices[0], GL_UNIFORM_OFFSET, &offsets[0]);
+	glGetActiveUniformsiv(programID, memberCount, &uniformIndices[0], GL_UNIFORM_TYPE, &types[0]);
+	glGetActiveUniformsiv(programID, memberCount, &uniformIndices[0], GL_UNIFORM_SIZE, &sizes[0]);
+	glGetActiveUniformsiv(programID, memberCount, &uniformIndices[0], GL_UNIFORM_ARRAY_STRIDE, &arrayStrides[0]);
+	glGetActiveUniformsiv(programID, memberCount, &uniformIndices[0], GL_UNIFORM_MATRIX_STRIDE, &matrixStrides[0]);
+
+	for (GLint i = 0; i < memberCount; i++) {
+		char name[256];
+		GLsizei length = 0;
+		glGetActiveUniformName(programID, uniformIndices[i], sizeof(name), &length, name);
+
+		UniformBlockMember member;
+		member.name = std::string(name, length);
+		if (member.name.size() > 3 && member.name.compare(member.name.size() - 3, 3, "[0]") == 0) {
+			member.name.erase(member.name.size() - 3);
+		}
+		member.offset = offsets[i];
+		member.type = (GLenum)types[i];
+		member.arraySize = sizes[i];
+		member.arrayStride = arrayStrides[i];
+		member.matrixStride = matrixStrides[i];
+
+		// Insertion sort by offset; blocks have few members.
+		std::vector<UniformBlockMember>::iterator position = members.begin();
+		while (position != members.end() && position->offset < member.offset) {
+			++position;
+		}
+		members.insert(position, member);
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// The C++ type, the number of components, and the number of matrix columns of a GLSL type.
+// std140 stores bool as a 4-byte integer and matrix columns matrixStride bytes apart.
+void uniformTypeInfo(GLenum type, const char*& cType, const char*& glslType, int& components, int& columns) {
+	cType = "float";
+	components = 1;
+	columns = 0;
+	switch (type) {
+		case GL_FLOAT: glslType = "float"; break;
+		case GL_FLOAT_VEC2: glslType = "vec2"; components = 2; break;
+		case GL_FLOAT_VEC3: glslType = "vec3"; components = 3; break;
+		case GL_FLOAT_VEC4: glslType = "vec4"; components = 4; break;
+		case GL_FLOAT_MAT2: glslType = "mat2"; columns = 2; break;
+		case GL_FLOAT_MAT3: glslType = "mat3"; columns = 3; break;
+		case GL_FLOAT_MAT4: glslType = "mat4"; columns = 4; break;
+		case GL_INT: cType = "int"; glslType = "int"; break;
+		case GL_INT_VEC2: cType = "int"; glslType = "ivec2"; components = 2; break;
+		case GL_INT_VEC3: cType = "int"; glslType = "ivec3"; components = 3; break;
+		case GL_INT_VEC4: cType = "int"; glslType = "ivec4"; components = 4; break;
+		case GL_UNSIGNED_INT: cType = "unsigned int"; glslType = "uint"; break;
+		case GL_UNSIGNED_INT_VEC2: cType = "unsigned int"; glslType = "uvec2"; components = 2; break;
+		case GL_UNSIGNED_INT_VEC3: cType = "unsigned int"; glslType = "uvec3"; components = 3; break;
+		case GL_UNSIGNED_INT_VEC4: cType = "unsigned int"; glslType = "uvec4"; components = 4; break;
+		case GL_BOOL: cType = "int"; glslType = "bool"; break;
+		default: glslType = "?"; break;
+	}
+}
+
+//---------------------------------------------------------
+// Write a C++ struct that matches the block layout, with explicit padding.
+std::string uniformBlockStruct(const char* structName, GLint dataSize, const std::vector<UniformBlockMember>& members) {
+	std::stringstream code;
+	code << "struct " << structName << " {" << std::endl;
+	GLint offset = 0;
+	int paddingCount = 0;
+	for (unsigned int i = 0; i < members.size(); i++) {
+		const UniformBlockMember& member = members[i];
+		if (member.offset > offset) {
+			code << "\tfloat padding" << paddingCount++ << "[" << (member.offset - offset) / 4 << "];" << std::endl;
+			offset = member.offset;
+		}
+
+		const char* cType;
+		const char* glslType;
+		int components, columns;
+		uniformTypeInfo(member.type, cType, glslType, components, columns);
+
+		// Size in 4-byte values. An array or matrix element takes its whole stride.
+		int elementValues = columns > 0 ? columns * member.matrixStride / 4 : components;
+		int values = member.arraySize > 1 ? member.arraySize * member.arrayStride / 4 : elementValues;
+		std::string name = member.name;
+		for (unsigned int c = 0; c < name.size(); c++) {
+			if (name[c] == '.') {
+				name[c] = '_';
+			}
+		}
+
+		code << "\t" << cType << " " << name;
+		if (values > 1) {
+			code << "[" << values << "]";
+		}
+		code << "; // " << glslType;
+		if (member.arraySize > 1) {
+			code << "[" << member.arraySize << "]";
+		}
+		code << " at offset " << member.offset << std::endl;
+		offset += values * 4;
+	}
+	if (dataSize > offset) {
+		code << "\tfloat padding" << paddingCount << "[" << (dataSize - offset) / 4 << "];" << std::endl;
+	}
+	code << "};" << std::endl;
+	return code.str();
+}
+
+//---------------------------------------------------------
+bool validateUniformBlock(GLuint programID, const char* blockName, const char* structName,
+	size_t structSize, const UniformBlockField* fields, size_t fieldCount) {
+	GLint dataSize = 0;
+	std::vector<UniformBlockMember> members;
+	if (!reflectUniformBlock(programID, blockName, dataSize, members)) {
+		return true;
+	}
+
+	std::stringstream errors;
+	for (unsigned int i = 0; i < members.size(); i++) {
+		const UniformBlockField* field = NULL;
+		for (size_t f = 0; f < fieldCount && !field; f++) {
+			if (members[i].name == fields[f].name) {
+				field = &fields[f];
+			}
+		}
+		if (!field) {
+			errors << "  " << members[i].name << " (offset " << members[i].offset << ") has no C++ member" << std::endl;
+		} else if ((size_t)members[i].offset != field->offset) {
+			errors << "  " << members[i].name << " is at offset " << members[i].offset
+				<< " in the block but at offset " << field->offset << " in " << structName << std::endl;
+		}
+	}
+	for (size_t f = 0; f < fieldCount; f++) {
+		bool found = false;
+		for (unsigned int i = 0; i < members.size() && !found; i++) {
+			found = members[i].name == fields[f].name;
+		}
+		if (!found) {
+			errors << "  " << fields[f].name << " is not a member of the block" << std::endl;
+		}
+	}
+	if (structSize < (size_t)dataSize) {
+		errors << "  " << structName << " is " << structSize << " bytes, but the block is "
+			<< dataSize << " bytes" << std::endl;
+	}
+
+	if (errors.str().empty()) {
+		return true;
+	}
+	std::cout << "Uniform block " << blockName << " does not match " << structName << ":" << std::endl
+		<< errors.str() << "This struct matches the block:" << std::endl
+		<< uniformBlockStruct(structName, dataSize, members);
+	return false;
+}
@@ -1,14 +1,16 @@
 #version 330
 
-layout (std140) uniform Material {
-uniform	vec4 diffuse;
-uniform	vec4 ambient;
-uniform	vec4 specular;
-uniform	vec4 emissive;
-uniform	float shininess;
-uniform	int texCount;
+#define MAX_MATERIALS 128
+
+// The material table of the model, 5 vec4 per material: diffuse, ambient, specular,
+// emissive, and (shininess, texture count stored as int bits, 0, 0)
+layout (std140) uniform Materials {
+uniform	vec4 materialData[MAX_MATERIALS * 5];
 };
 
+// The material of the mesh being drawn
+uniform int materialID;
+
 uniform	sampler2D texUnit;
 
 in vec3 Normal;
@@ -23,6 +25,11 @@ void main()
 	vec3 lightDir;
 	vec3 n;
 	
+	int base = materialID * 5;
+	vec4 diffuse = materialData[base];
+	vec4 ambient = materialData[base + 1];
+	int texCount = floatBitsToInt(materialData[base + 4].y);
+
 	lightDir = normalize(vec3(1.0,1.0,1.0));
 	n = normalize(Normal);	
 	intensity = max(dot(lightDir,n),0.0);
@@ -33,7 +33,10 @@ EXTRA CREDIT = Roll (R)
 #endif
 
 #include <math.h>
+#include <stddef.h>
+#include <chrono>
 #include <fstream>
+#include <iostream>
 #include <map>
 #include <string>
 #include <vector>
@@ -48,6 +51,13 @@ EXTRA CREDIT = Roll (R)
 #include <GL/freeglut.h> // GLUT is the toolkit to interface with the OS
 
 #include "textfile.h" // auxiliary C file to read the shader text files
+#include "program_cache.hpp" // linked programs are stored in shader_cache/
+#include "uniform_layout.hpp" // checks the uniform block layouts against the C structs
+#include "job_system.hpp" // runs the mesh and node work on every core
+#include "render_commands.hpp" // draw calls recorded on the worker threads
+#include "fixed_update.hpp" // the update thread that owns the scene state
+#include "input_latency.hpp" // measures the time from a key to the frame that shows it
+#include "input_session.hpp" // records and replays the keys and window sizes
 
 
 //==================================================
@@ -60,7 +70,8 @@ struct MiMesh
 {
 
 	int numberFaces;
-	GLuint vao, textIndex, blockIndex;
+	GLuint vao, textIndex;
+	int materialID; // index of the mesh's material in the material table
 
 };
 
@@ -68,14 +79,29 @@ std::vector<struct MiMesh> MiMeshes;
 
 // Shader uniform block
 // Create object
+// A material is stored as 5 vec4 in the Materials block: diffuse, ambient, specular,
+// emissive, and (shininess, texture count, 0, 0).
 struct MiMaterial
 {
 
 	float diff[4], ambi[4], spec[4], emiss[4], shiney;
 	int textCount;
+	float padding[2]; // fills the last vec4
 
 };
 
+// The shader reads the table as a vec4 array, so the driver cannot check the members;
+// the compiler checks that they sit where the shader reads them.
+static_assert(sizeof(MiMaterial) == 5 * 16, "MiMaterial must be 5 vec4");
+static_assert(offsetof(MiMaterial, ambi) == 16 && offsetof(MiMaterial, spec) == 32
+	&& offsetof(MiMaterial, emiss) == 48, "each MiMaterial color must be one vec4");
+static_assert(offsetof(MiMaterial, shiney) == 64, "shiney must be the x of the 5th vec4");
+static_assert(offsetof(MiMaterial, textCount) == 68, "textCount must be the y of the 5th vec4");
+
+// The material table: every distinct material of the model, once. The meshes refer
+// to it by materialID, and the whole table is in one uniform buffer.
+std::vector<struct MiMaterial> materialTable;
+
 // Model Matrix
 float matrixModelX[16];
 
@@ -94,12 +120,31 @@ GLuint unitText = 0;
 // Uniform Buffer for Matrices (contain 3 matrices: projection, view and model)
 GLuint uniBufferMatix;
 
+// Uniform Buffer for the material table, and the uniform that selects a material
+GLuint uniBufferMaterials;
+GLint uniMaterialID;
+
+// Must match MAX_MATERIALS in the fragment shader
+#define MaxMaterials 128
+#define MaterialsUniBufferSize sizeof(struct MiMaterial) * MaxMaterials
+
 #define MatricesUniBufferSize sizeof(float) * 16 * 3
 #define ProjMatrixOffset 0
 #define ViewMatrixOffset sizeof(float) * 16
 #define ModelMatrixOffset sizeof(float) * 16 * 2
 #define MatrixSize sizeof(float) * 16
 
+// The members of the uniform blocks and where the C side writes them
+const UniformBlockField matricesFields[] = {
+	{ "projMatrix", ProjMatrixOffset },
+	{ "viewMatrix", ViewMatrixOffset },
+	{ "modelMatrix", ModelMatrixOffset }
+};
+
+const UniformBlockField materialFields[] = {
+	{ "materialData", 0 }
+};
+
 // Program and Shader Identifiers
 GLuint  vertexShader, fragmentShader, prog;
 
@@ -116,6 +161,45 @@ const aiScene* sceneOnScreen = NULL;
 // Changes size for model to fit in the window
 float modelWindowSize;
 
+// Worker threads for the CPU work on the model: the bounding box, the mesh arrays,
+// and the node transformations of each frame
+JobSystem jobSystem;
+
+// Vertices or faces per job when a large mesh is split between the threads
+#define JobGrainSize 16384
+
+// The node tree in depth-first order, so that every node comes after its parent and
+// the nodes below each child of the root are one contiguous range
+struct MiNode
+{
+
+	const aiNode *node;
+	int parent; // index in sceneNodes, -1 for the root
+	float transform[16]; // node transformation, column major
+
+};
+
+std::vector<struct MiNode> sceneNodes;
+
+// The model matrix of every node (16 floats per node), and the model matrix of the
+// whole model that the root node is drawn with
+std::vector<float> nodeMatrices;
+float rootMatrix[16];
+
+// Composes nodeMatrices: the root first, then the subtrees of its children in parallel
+TaskGraph transformGraph;
+
+// Subtrees of the root are grouped into tasks of at least this many nodes
+#define TransformGrainSize 64
+
+// The draw calls of the nodes, recorded on the worker threads and replayed on the
+// thread that owns the OpenGL context. The next frame is recorded while the current
+// one is drawn.
+RenderFramePipeline scenePipeline;
+
+// Nodes recorded into one command buffer
+#define RecordGrainSize 64
+
 // Map image filenames to textureIds
 // pointer to texture Array
 std::map<std::string, GLuint> textMap;
@@ -131,11 +215,97 @@ static const std::string modelFile = "car.obj";
 float cameraX = 0, cameraY = 0, cameraZ = 5;
 
 // Camera Coordinates
-float alpha = 0.0f, beta = 0.0f, r = 5.0f;
+float alpha = 0.0f, beta = 0.0f;
+
+//==================================================
+// Scene State
+//==================================================
+
+// The state of the scene that the keys change
+struct SceneState
+{
+
+	float xTrans, yTrans, zTrans; // translation of the model
+	float p, q, m; // rotation about the x, y and z axes
+	float r;
+
+};
+
+const struct SceneState initialSceneState = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 5.0f };
+
+// The scene after one update step: the state before and after the step, so that the
+// rendering can interpolate between them
+struct SceneSnapshot
+{
+
+	struct SceneState previous, current;
+	unsigned long long step;
+	std::chrono::steady_clock::time_point stepTime;
+
+};
+
+// A key passed from the keyboard callbacks to the update thread
+struct KeyEvent
+{
+
+	int key;
+	bool special; // a key of processSpecialKeys()
+	std::chrono::steady_clock::time_point arrived; // when the callback got it
+
+};
+
+// The update thread owns sceneState and changes it at a fixed timestep. The keyboard
+// callbacks only queue their keys, and scene_Render() only reads the snapshots the
+// update thread publishes, so input, simulation and rendering never wait for each other.
+struct SceneState sceneState = initialSceneState;
+unsigned long long sceneStep = 0;
+FixedUpdateThread updateThread;
+SpscQueue<struct KeyEvent, 256> keyEvents;
+TripleBuffer<struct SceneSnapshot> sceneSnapshots;
+
+// 120 updates per second
+#define UpdateStepSeconds (1.0 / 120.0)
+
+//==================================================
+// Input Latency
+//==================================================
+
+// A key the update thread has applied, and the step that applied it. The first frame
+// drawn from that step or a later one consumes the key.
+struct AppliedKey
+{
+
+	InputStamp stamp;
+	unsigned long long step;
+
+};
 
-float xTrans = 0.0f, yTrans = 0.0f, zTrans = 0.0f;
+// Keys passed back from the update thread, the ones no frame has consumed yet, and the
+// latency of the consumed ones. Press 'l' for the percentiles.
+SpscQueue<struct AppliedKey, 256> appliedKeys;
+std::vector<struct AppliedKey> unconsumedKeys;
+InputLatencyMonitor inputLatency;
+bool inputLatencyReleased = false;
+
+// Synthetic input (--synthetic-input N on the command line): N arrow keys, one every
+// SyntheticInputFrames frames, then the percentiles are printed and the program quits.
+// Left and right alternate, so the model rocks in place.
+int syntheticInputCount = 0;
+int syntheticInputsSent = 0;
+int syntheticFrame = 0;
+#define SyntheticInputFrames 10
 
-static float q = 0.0f, p = 0.0f, m = 0.0f;
+//==================================================
+// Input Sessions
+//==================================================
+
+// --record FILE writes the keys and window sizes of the session with the frame each one
+// arrived in. --replay FILE plays them back, one update step per frame, then prints the
+// frame times and quits; --replay-frames FILE also writes the time and image hash of
+// every replayed frame (the frames are only read back for the hashes then).
+InputRecorder sessionRecorder;
+InputPlayer sessionPlayer;
+const char *replayFramesFile = NULL;
 
 #define M_PI       3.14159265f
 
@@ -446,25 +616,33 @@ void setViewCamera(float xPos, float yPos, float zPos,
 #define aisgl_min(x,y) (x<y?x:y)
 #define aisgl_max(x,y) (y>x?y:x)
 
-void get_container_for_node(const aiNode* nd, aiVector3D* minX, aiVector3D* maxX)
+// A range of vertices of one mesh and its bounding box. The boxes of the ranges are
+// computed in parallel and then combined.
+struct MiVertexRange
+{
+
+	const aiMesh *mesh;
+	unsigned int begin, end;
+	aiVector3D minX, maxX;
+
+};
+
+// Collect the vertex ranges of the meshes attached to nd and its children
+void get_container_for_node(const aiNode* nd, std::vector<struct MiVertexRange> &ranges)
 {
-	aiMatrix4x4 previous;
 	unsigned int n = 0, t;
 
 	for (; n < nd->mNumMeshes; ++n)
 	{
 		const aiMesh* mesh = sceneOnScreen->mMeshes[nd->mMeshes[n]];
-		for (t = 0; t < mesh->mNumVertices; ++t)
+		for (t = 0; t < mesh->mNumVertices; t += JobGrainSize)
 		{
 
-			aiVector3D temp = mesh->mVertices[t];
-
-			minX->x = aisgl_min(minX->x, temp.x);
-			minX->y = aisgl_min(minX->y, temp.y);
-			minX->z = aisgl_min(minX->z, temp.z);
-			maxX->x = aisgl_max(maxX->x, temp.x);
-			maxX->y = aisgl_max(maxX->y, temp.y);
-			maxX->z = aisgl_max(maxX->z, temp.z);
+			struct MiVertexRange range;
+			range.mesh = mesh;
+			range.begin = t;
+			range.end = aisgl_min(mesh->mNumVertices, t + JobGrainSize);
+			ranges.push_back(range);
 
 		}
 	}
@@ -472,7 +650,7 @@ void get_container_for_node(const aiNode* nd, aiVector3D* minX, aiVector3D* maxX
 	for (n = 0; n < nd->mNumChildren; ++n)
 	{
 
-		get_container_for_node(nd->mChildren[n], minX, maxX);
+		get_container_for_node(nd->mChildren[n], ranges);
 
 	}
 }
@@ -480,9 +658,44 @@ void get_container_for_node(const aiNode* nd, aiVector3D* minX, aiVector3D* maxX
 void get_container(aiVector3D* minX, aiVector3D* maxX)
 {
 
+	std::vector<struct MiVertexRange> ranges;
+	get_container_for_node(sceneOnScreen->mRootNode, ranges);
+
+	// One job per range
+	jobSystem.parallelFor((unsigned int)ranges.size(), [&ranges](unsigned int i)
+	{
+		struct MiVertexRange &range = ranges[i];
+		range.minX.x = range.minX.y = range.minX.z = 1e10f;
+		range.maxX.x = range.maxX.y = range.maxX.z = -1e10f;
+
+		for (unsigned int t = range.begin; t < range.end; ++t)
+		{
+
+			aiVector3D temp = range.mesh->mVertices[t];
+
+			range.minX.x = aisgl_min(range.minX.x, temp.x);
+			range.minX.y = aisgl_min(range.minX.y, temp.y);
+			range.minX.z = aisgl_min(range.minX.z, temp.z);
+			range.maxX.x = aisgl_max(range.maxX.x, temp.x);
+			range.maxX.y = aisgl_max(range.maxX.y, temp.y);
+			range.maxX.z = aisgl_max(range.maxX.z, temp.z);
+
+		}
+	});
+
 	minX->x = minX->y = minX->z = 1e10f;
 	maxX->x = maxX->y = maxX->z = -1e10f;
-	get_container_for_node(sceneOnScreen->mRootNode, minX, maxX);
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+
+		minX->x = aisgl_min(minX->x, ranges[i].minX.x);
+		minX->y = aisgl_min(minX->y, ranges[i].minX.y);
+		minX->z = aisgl_min(minX->z, ranges[i].minX.z);
+		maxX->x = aisgl_max(maxX->x, ranges[i].maxX.x);
+		maxX->y = aisgl_max(maxX->y, ranges[i].maxX.y);
+		maxX->z = aisgl_max(maxX->z, ranges[i].maxX.z);
+
+	}
 }
 
 //===================================================================
@@ -548,34 +761,133 @@ void color4_to_float4(const aiColor4D *c, float f[4])
 }
 
 
+// The CPU side of a mesh: the arrays that go into its VBOs and its material.
+// They are built for all the meshes in parallel before the buffers are created.
+struct MiMeshArrays
+{
+
+	std::vector<unsigned int> faceArray;
+	std::vector<float> texCoords;
+	struct MiMaterial material;
+	bool hasTexture;
+	std::string texturePath;
+
+};
+
+// Fill the arrays of mesh n. Only reads the aiScene, so meshes can be done in parallel.
+void buildMeshArrays(const aiScene *fd, unsigned int n, struct MiMeshArrays &arrays)
+{
+
+	// Get the current aiMesh object.
+	const aiMesh* mesh = fd->mMeshes[n];
+
+	// Create array with faces
+	// have to convert from Assimp format to array
+	arrays.faceArray.resize(mesh->mNumFaces * 3);
+
+	// Copy face indices from aiMesh to faceArray. A large mesh is split between the threads.
+	jobSystem.parallelForRange(mesh->mNumFaces, JobGrainSize, [mesh, &arrays](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t) {
+			const aiFace* face = &mesh->mFaces[t]; // Go through the list of aiFace
+
+			// For each aiFace, copy its indices to faceArray.
+			memcpy(&arrays.faceArray[t * 3], face->mIndices, 3 * sizeof(unsigned int));
+		}
+	});
+
+	// Texture coordinates are 3D in Assimp; the VBO holds the first two
+	if (mesh->HasTextureCoords(0))
+	{
+		arrays.texCoords.resize(mesh->mNumVertices * 2);
+		jobSystem.parallelForRange(mesh->mNumVertices, JobGrainSize, [mesh, &arrays](size_t begin, size_t end)
+		{
+			for (size_t k = begin; k < end; ++k)
+			{
+
+				arrays.texCoords[k * 2] = mesh->mTextureCoords[0][k].x;
+				arrays.texCoords[k * 2 + 1] = mesh->mTextureCoords[0][k].y;
+
+			}
+		});
+	}
+
+	aiMaterial *material = fd->mMaterials[mesh->mMaterialIndex];
+	struct MiMaterial &aMat = arrays.material;
+
+	// Zero the padding too, so that equal materials compare equal byte for byte
+	memset(&aMat, 0, sizeof(aMat));
+
+	aiString texPath;	//contains filename of texture
+	if (AI_SUCCESS == material->GetTexture(aiTextureType_DIFFUSE, 0, &texPath))
+	{
+
+		// The texture ID is looked up in textMap when the VAO is created
+		arrays.hasTexture = true;
+		arrays.texturePath = texPath.data;
+		aMat.textCount = 1;
+	}
+	else
+	{
+		arrays.hasTexture = false;
+		aMat.textCount = 0;
+	}
+
+	float c[4];
+	set_float4(c, 0.8f, 0.8f, 0.8f, 1.0f);
+	aiColor4D diff;
+	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diff))
+		color4_to_float4(&diff, c);
+	memcpy(aMat.diff, c, sizeof(c));
+
+	set_float4(c, 0.2f, 0.2f, 0.2f, 1.0f);
+	aiColor4D ambi;
+	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_AMBIENT, &ambi))
+		color4_to_float4(&ambi, c);
+	memcpy(aMat.ambi, c, sizeof(c));
+
+	set_float4(c, 0.0f, 0.0f, 0.0f, 1.0f);
+	aiColor4D spec;
+	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &spec))
+		color4_to_float4(&spec, c);
+	memcpy(aMat.spec, c, sizeof(c));
+
+	set_float4(c, 0.0f, 0.0f, 0.0f, 1.0f);
+	aiColor4D emission;
+	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_EMISSIVE, &emission))
+		color4_to_float4(&emission, c);
+	memcpy(aMat.emiss, c, sizeof(c));
+
+	float shiney = 0.0;
+	unsigned int max = 1;
+	aiGetMaterialFloatArray(material, AI_MATKEY_SHININESS, &shiney, &max);
+	aMat.shiney = shiney;
+}
+
 // Function that loads 3d model to window
 void generateVAOandUBuffer(const aiScene *fd)
 {
 
 	GLuint buffer;
-	struct MiMaterial aMat;
 	struct MiMesh aMesh;
 
+	materialTable.clear();
+
+	// Build the face arrays, texture coordinates, and materials of all the meshes on
+	// the job system's threads. The OpenGL calls below stay on this thread.
+	std::vector<struct MiMeshArrays> meshArrays(fd->mNumMeshes);
+	jobSystem.parallelFor(fd->mNumMeshes, [fd, &meshArrays](unsigned int n)
+	{
+		buildMeshArrays(fd, n, meshArrays[n]);
+	});
+
 	// For each mesh in the aiScene object
 	for (unsigned int n = 0; n < fd->mNumMeshes; ++n)
 	{
-		// Get the current aiMesh object.
+		// Get the current aiMesh object and its arrays.
 		const aiMesh* mesh = fd->mMeshes[n];
+		const struct MiMeshArrays &arrays = meshArrays[n];
 
-		// Create array with faces
-		// have to convert from Assimp format to array
-		unsigned int *faceArray;
-		faceArray = (unsigned int *)malloc(sizeof(unsigned int)* mesh->mNumFaces * 3);
-		unsigned int faceIndex = 0;
-
-		// Copy face indices from aiMesh to faceArray. 
-		for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
-			const aiFace* face = &mesh->mFaces[t]; // Go through the list of aiFace
-
-			// For each aiFace, copy its indices to faceArray.
-			memcpy(&faceArray[faceIndex], face->mIndices, 3 * sizeof(unsigned int));
-			faceIndex += 3;
-		}
 		aMesh.numberFaces = fd->mMeshes[n]->mNumFaces;
 
 		// Generate A Vertex Array Object for mesh
@@ -588,7 +900,8 @@ void generateVAOandUBuffer(const aiScene *fd)
 		glGenBuffers(1, &buffer);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
 		// Fill the buffer with indices
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)* mesh->mNumFaces * 3, faceArray, GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)* mesh->mNumFaces * 3,
+			arrays.faceArray.empty() ? NULL : &arrays.faceArray[0], GL_STATIC_DRAW);
 
 		// Generate a Vertex Buffer Object (VBO) for vertex positions
 		if (mesh->HasPositions())
@@ -616,19 +929,11 @@ void generateVAOandUBuffer(const aiScene *fd)
 		}
 
 		// Generate a Vertex Buffer Object (VBO) for vertex texture coordinates
-		if (mesh->HasTextureCoords(0))
+		if (!arrays.texCoords.empty())
 		{
-			float *texCoords = (float *)malloc(sizeof(float) * 2 * mesh->mNumVertices);
-			for (unsigned int k = 0; k < mesh->mNumVertices; ++k)
-			{
-
-				texCoords[k * 2] = mesh->mTextureCoords[0][k].x;
-				texCoords[k * 2 + 1] = mesh->mTextureCoords[0][k].y;
-
-			}
 			glGenBuffers(1, &buffer);
 			glBindBuffer(GL_ARRAY_BUFFER, buffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * mesh->mNumVertices, texCoords, GL_STATIC_DRAW);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * mesh->mNumVertices, &arrays.texCoords[0], GL_STATIC_DRAW);
 			glEnableVertexAttribArray(coorLoc);
 			glVertexAttribPointer(coorLoc, 2, GL_FLOAT, 0, 0, 0);
 		}
@@ -638,63 +943,131 @@ void generateVAOandUBuffer(const aiScene *fd)
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-		// Create material uniform buffer
-		aiMaterial *material = fd->mMaterials[mesh->mMaterialIndex];
+		// Retrieve texture ID from the hash map and store it in the aMesh data structure. 
+		// These texture IDs will be used in renderNodes() to bind the texture. 
+		aMesh.textIndex = arrays.hasTexture ? textMap[arrays.texturePath] : 0;
 
-		aiString texPath;	//contains filename of texture
-		if (AI_SUCCESS == material->GetTexture(aiTextureType_DIFFUSE, 0, &texPath))
+		// Meshes with the same material share one entry of the material table
+		const struct MiMaterial &aMat = arrays.material;
+		aMesh.materialID = -1;
+		for (unsigned int m = 0; m < materialTable.size() && aMesh.materialID < 0; ++m)
 		{
-
-			// Retrieve texture ID from the hash map and store it in the aMesh data structure. 
-			// These texture IDs will be used in renderRecur() to bind the texture. 
-			unsigned int texId = textMap[texPath.data];
-			aMesh.textIndex = texId;
-			aMat.textCount = 1;
+			if (memcmp(&materialTable[m], &aMat, sizeof(aMat)) == 0)
+				aMesh.materialID = m;
+		}
+		if (aMesh.materialID < 0)
+		{
+			if (materialTable.size() < MaxMaterials)
+			{
+				aMesh.materialID = (int)materialTable.size();
+				materialTable.push_back(aMat);
+			}
+			else
+			{
+				printf("More than %d materials; mesh %u uses material 0\n", MaxMaterials, n);
+				aMesh.materialID = 0;
+			}
 		}
-		else
-			aMat.textCount = 0;
-
-		float c[4];
-		set_float4(c, 0.8f, 0.8f, 0.8f, 1.0f);
-		aiColor4D diff;
-		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diff))
-			color4_to_float4(&diff, c);
-		memcpy(aMat.diff, c, sizeof(c));
-
-		set_float4(c, 0.2f, 0.2f, 0.2f, 1.0f);
-		aiColor4D ambi;
-		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_AMBIENT, &ambi))
-			color4_to_float4(&ambi, c);
-		memcpy(aMat.ambi, c, sizeof(c));
-
-		set_float4(c, 0.0f, 0.0f, 0.0f, 1.0f);
-		aiColor4D spec;
-		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &spec))
-			color4_to_float4(&spec, c);
-		memcpy(aMat.spec, c, sizeof(c));
-
-		set_float4(c, 0.0f, 0.0f, 0.0f, 1.0f);
-		aiColor4D emission;
-		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_EMISSIVE, &emission))
-			color4_to_float4(&emission, c);
-		memcpy(aMat.emiss, c, sizeof(c));
-
-		float shiney = 0.0;
-		unsigned int max;
-		aiGetMaterialFloatArray(material, AI_MATKEY_SHININESS, &shiney, &max);
-		aMat.shiney = shiney;
-
-		// Create a Uniform Buffer Object for the uniform variable block Materials
-		// in the fragment shader. 
-		glGenBuffers(1, &(aMesh.blockIndex));
-		glBindBuffer(GL_UNIFORM_BUFFER, aMesh.blockIndex);
-		// Fills UBO with material data.
-		glBufferData(GL_UNIFORM_BUFFER, sizeof(aMat), (void *)(&aMat), GL_STATIC_DRAW);
 
 		MiMeshes.push_back(aMesh);
 	}
+
+	// Create one Uniform Buffer Object for the uniform variable block Materials
+	// in the fragment shader and fill it with the material table. 
+	// It is bound once here; the draws only select a material with materialID. 
+	glGenBuffers(1, &uniBufferMaterials);
+	glBindBuffer(GL_UNIFORM_BUFFER, uniBufferMaterials);
+	glBufferData(GL_UNIFORM_BUFFER, MaterialsUniBufferSize, NULL, GL_STATIC_DRAW);
+	if (!materialTable.empty())
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(struct MiMaterial) * materialTable.size(), &materialTable[0]);
+	glBindBufferRange(GL_UNIFORM_BUFFER, uniLocMaterial, uniBufferMaterials, 0, MaterialsUniBufferSize);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	printf("%u meshes share %u materials\n", fd->mNumMeshes, (unsigned int)materialTable.size());
+}
+
+//=========================================================
+// Node transformations
+//=========================================================
+
+// Append nd and its children to sceneNodes in depth-first order
+void flattenNodes(const aiNode *nd, int parent)
+{
+
+	struct MiNode node;
+	node.node = nd;
+	node.parent = parent;
+
+	// Get node transformation matrix
+	aiMatrix4x4 m = nd->mTransformation;
+	// OpenGL matrices are column major
+	m.Transpose();
+	memcpy(node.transform, &m, sizeof(float) * 16);
+	sceneNodes.push_back(node);
+
+	int index = (int)sceneNodes.size() - 1;
+	for (unsigned int n = 0; n < nd->mNumChildren; ++n)
+	{
+
+		flattenNodes(nd->mChildren[n], index);
+
+	}
 }
 
+// Model matrices of the nodes begin ... end - 1. Their parents come before them,
+// so each parent matrix is ready when its children need it.
+void composeNodeRange(size_t begin, size_t end)
+{
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		float *matrix = &nodeMatrices[i * 16];
+		int parent = sceneNodes[i].parent;
+		memcpy(matrix, parent < 0 ? rootMatrix : &nodeMatrices[parent * 16], sizeof(float) * 16);
+		matMulti(matrix, sceneNodes[i].transform);
+	}
+}
+
+// Flatten the node tree of the scene and build the task graph that composes its
+// matrices: one task for the root, then one task per group of subtrees of its children.
+void buildTransformGraph(const aiScene *fd)
+{
+
+	sceneNodes.clear();
+	transformGraph.clear();
+	flattenNodes(fd->mRootNode, -1);
+	nodeMatrices.resize(sceneNodes.size() * 16);
+
+	unsigned int root = transformGraph.add([]() { composeNodeRange(0, 1); });
+
+	size_t begin = 1;
+	for (size_t i = 1; i <= sceneNodes.size(); ++i)
+	{
+		// A child of the root starts a new subtree. Small subtrees are grouped.
+		bool groupEnds = i == sceneNodes.size() ? i > begin
+			: sceneNodes[i].parent == 0 && i - begin >= TransformGrainSize;
+		if (groupEnds)
+		{
+			size_t end = i;
+			unsigned int group = transformGraph.add([begin, end]() { composeNodeRange(begin, end); });
+			transformGraph.precede(root, group);
+			begin = i;
+		}
+	}
+}
+
+// Compose the model matrix of every node with the given model matrix of the root
+void composeNodeTransforms(const float *modelMatrix)
+{
+
+	memcpy(rootMatrix, modelMatrix, sizeof(float) * 16);
+
+	// With a single group of subtrees there is nothing to run in parallel
+	if (transformGraph.size() <= 2)
+		composeNodeRange(0, sceneNodes.size());
+	else
+		transformGraph.run(jobSystem);
+}
 
 //=========================================================
 // Window reshape Callback Function
@@ -703,6 +1076,8 @@ void generateVAOandUBuffer(const aiScene *fd)
 void alterSize(int width, int height)
 {
 
+	sessionRecorder.record(INPUT_RESHAPE, width, height, 0);
+
 	float ratio;
 	// Prevent a divide by zero, when window is too short
 	// (you cant make a window of zero width).
@@ -721,49 +1096,315 @@ void alterSize(int width, int height)
 //=========================================================
 
 // Render Assimp Model
-// Shows how to traverse the node tree in a aiScene object and draw the 3D meshes attached to each node.
-void renderRecur(const aiScene *fd, const aiNode* nd)
+// Shows how to draw the 3D meshes attached to each node of the aiScene object. The node
+// tree was flattened by buildTransformGraph(), and composeNodeTransforms() has computed
+// the model matrix of every node. The draw calls of the nodes begin ... end - 1 are
+// recorded into a command buffer instead of being made here, so this runs on the
+// worker threads.
+void recordNodeRange(size_t begin, size_t end, RenderCommandBuffer &commands)
 {
 
-	// Get node transformation matrix
-	aiMatrix4x4 m = nd->mTransformation;
-	// OpenGL matrices are column major
-	m.Transpose();
+	for (size_t i = begin; i < end; ++i)
+	{
+		const aiNode* nd = sceneNodes[i].node;
+		if (nd->mNumMeshes == 0)
+			continue;
+
+		// Set the model matrix of the node (the matrix is copied into the command)
+		commands.bufferSubData(GL_UNIFORM_BUFFER, uniBufferMatix,
+			ModelMatrixOffset, MatrixSize, &nodeMatrices[i * 16]);
+
+		// Draws all meshes assigned to this node
+		for (unsigned int n = 0; n < nd->mNumMeshes; ++n)
+		{
+			// select the mesh's material in the material table
+			commands.uniform1i(uniMaterialID, MiMeshes[nd->mMeshes[n]].materialID);
 
-	// Save model matrix and apply node transformation
-	pushMat();
+			// glActiveTexture() indicates which texture unit the texture image will be sent to. 
+			// BindTexture" means that a texture image is transferred from main memory to GPU memory.
+			commands.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, MiMeshes[nd->mMeshes[n]].textIndex);
+
+			// Bind VAO, which contains the VBOs for indices, positions, normals, and texture coordinates.
+			commands.bindVertexArray(MiMeshes[nd->mMeshes[n]].vao);
+			// Used because we have an index buffer in the VAO. 
+			commands.drawElements(GL_TRIANGLES, MiMeshes[nd->mMeshes[n]].numberFaces * 3, GL_UNSIGNED_INT, 0);
+
+		}
+	}
+}
+
+// Compose the model matrices of all the nodes with the model matrix of the root, then
+// record their draw calls, RecordGrainSize nodes per command buffer
+void recordNodes(RenderFrame &frame, const float *modelMatrix)
+{
+
+	composeNodeTransforms(modelMatrix);
+
+	unsigned int jobCount = (unsigned int)((sceneNodes.size() + RecordGrainSize - 1) / RecordGrainSize);
+	frame.reset(jobCount);
+	jobSystem.parallelFor(jobCount, [&frame](unsigned int job)
+	{
+		size_t begin = (size_t)job * RecordGrainSize;
+		size_t end = std::min(sceneNodes.size(), begin + (size_t)RecordGrainSize);
+		recordNodeRange(begin, end, frame.buffer(job));
+	});
+}
+
+// Identifies the model matrix a frame was recorded with (FNV-1a hash of its bytes)
+unsigned long long modelMatrixTag(const float *modelMatrix)
+{
+
+	const unsigned char *bytes = (const unsigned char *)modelMatrix;
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < sizeof(float) * 16; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// The model matrix scene_Render() builds for a scene state, without the uniform buffer
+void sceneModelMatrix(const struct SceneState &state, float *modelMatrix)
+{
 
 	float change[16];
-	memcpy(change, &m, sizeof(float) * 16);
-	matMulti(matrixModelX, change);
-	setMatrixModelX();
 
-	// Draws all meshes assigned to this node
-	for (unsigned int n = 0; n < nd->mNumMeshes; ++n)
+	setMatrixIdentity(modelMatrix, 4);
+	setMatrixScale(change, modelWindowSize, modelWindowSize, modelWindowSize);
+	matMulti(modelMatrix, change);
+	setMatrixRotation(change, state.p, 1.0f, 0.0f, 0.0f);
+	matMulti(modelMatrix, change);
+	setMatrixRotation(change, state.q, 0.0f, 1.0f, 0.0f);
+	matMulti(modelMatrix, change);
+	setMatrixRotation(change, state.m, 0.0f, 0.0f, 1.0f);
+	matMulti(modelMatrix, change);
+}
+
+// Draw the nodes with the current model matrix. The frame recorded during the last call
+// is drawn if it was recorded with the same matrix (or is the last frame drawn and the
+// matrix has not changed), else the frame is recorded now. The next frame starts
+// recording from the next state before this one is drawn; scene_Render() waits for it
+// after the swap, since the keyboard callbacks change the matrices.
+void renderNodes(const struct SceneState &next)
+{
+
+	float modelMatrix[16], nextModelMatrix[16];
+	memcpy(modelMatrix, matrixModelX, sizeof(float) * 16);
+	sceneModelMatrix(next, nextModelMatrix);
+	unsigned long long tag = modelMatrixTag(modelMatrix);
+	unsigned long long nextTag = modelMatrixTag(nextModelMatrix);
+
+	RenderFrame *frame = scenePipeline.takeRecorded(tag);
+	if (frame == NULL)
 	{
-		// bind material uniform
-		glBindBufferRange(GL_UNIFORM_BUFFER, uniLocMaterial, MiMeshes[nd->mMeshes[n]].blockIndex, 0, sizeof(struct MiMaterial));
+		std::function<void(RenderFrame&)> record = [modelMatrix](RenderFrame &frame)
+		{
+			recordNodes(frame, modelMatrix);
+		};
+		frame = scenePipeline.record(jobSystem, tag, record);
+	}
 
-		// glActiveTexture() indicates which texture unit the texture image will be sent to. 
-		glActiveTexture(GL_TEXTURE0);
-		// BindTexture" means that a texture image is transferred from main memory to GPU memory.
-		glBindTexture(GL_TEXTURE_2D, MiMeshes[nd->mMeshes[n]].textIndex);
+	std::function<void(RenderFrame&)> recordNext = [nextModelMatrix](RenderFrame &frame)
+	{
+		recordNodes(frame, nextModelMatrix);
+	};
+	scenePipeline.beginRecording(jobSystem, nextTag, recordNext);
+	frame->execute();
+}
 
-		// Bind VAO, which contains the VBOs for indices, positions, normals, and texture coordinates.
-		glBindVertexArray(MiMeshes[nd->mMeshes[n]].vao);
-		// Used because we have an index buffer in the VAO. 
-		glDrawElements(GL_TRIANGLES, MiMeshes[nd->mMeshes[n]].numberFaces * 3, GL_UNSIGNED_INT, 0);
+//===========================================================
+// Scene Update
+//===========================================================
 
+// Change the scene state for a key. Runs on the update thread.
+void applyKey(struct SceneState &state, const struct KeyEvent &event)
+{
+	float f = .50f;
+	if (!event.special)
+	{
+		switch (event.key) {
+			case 'h': state.r += 0.1f; break;
+
+			case 'X': state.xTrans -= f; 
+				break;
+			case 'x': state.xTrans += f; 
+				break;
+
+			case 'Y': state.yTrans -= f; 
+				break;
+			case 'y': state.yTrans += f; 
+				break;
+
+			case 'Z': state.zTrans -= f; 
+				break;
+			case 'z': state.zTrans += f; 
+				break; 
+
+			case 'R': ++state.m;//++m; 
+				break; // Roll
+			
+			case 'o':	// Default, resets the translations vies from starting view
+				state.xTrans = state.yTrans = 0.0f;
+				state.zTrans = 0.0f;
+				break;
+		}
+		return;
 	}
 
-	// draw all children
-	for (unsigned int n = 0; n < nd->mNumChildren; ++n)
+	switch (event.key) {
+
+	    case GLUT_KEY_LEFT: --state.q; break; // rotate clockwisen y-axis
+		case GLUT_KEY_RIGHT: ++state.q; break; // rotate counterclockwise y-axis
+
+		case GLUT_KEY_UP: --state.p; break; // rotate clockwise x-axis
+		case GLUT_KEY_DOWN: ++state.p; break; // rotate counterclockwise x-axis
+
+		case GLUT_KEY_HOME:	// Default, resets the translations vies from starting view
+			state.q = state.p = 0.0f;
+			break;
+	}
+}
+
+// One step of the update thread: apply the keys queued since the last step and publish
+// the new state. Any per-step simulation goes here, off the rendering thread.
+void updateScene()
+{
+
+	struct SceneSnapshot &snapshot = sceneSnapshots.writeBuffer();
+	snapshot.previous = sceneState;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	// The applied keys are passed back before the snapshot is published, so the frame
+	// that draws the snapshot finds them. If the queue is full, the key is not measured.
+	struct KeyEvent event;
+	while (keyEvents.pop(event))
+	{
+		applyKey(sceneState, event);
+		struct AppliedKey applied = { { event.arrived, now }, sceneStep + 1 };
+		appliedKeys.push(applied);
+	}
+
+	snapshot.current = sceneState;
+	snapshot.step = ++sceneStep;
+	snapshot.stepTime = now;
+	sceneSnapshots.publish();
+}
+
+// The scene state to draw from a snapshot, interpolated from its previous state to its
+// current one over the step that follows it
+struct SceneState interpolateSnapshot(const struct SceneSnapshot &snapshot)
+{
+
+	// A replay steps once per frame and shows each step whole, so it does not depend on the clock.
+	// A whole step is the current state exactly, so that its frame can be recorded ahead.
+	float t = sessionPlayer.isOpen() ? 1.0f : interpolationFactor(snapshot.stepTime, UpdateStepSeconds);
+	if (t >= 1.0f)
+		return snapshot.current;
+
+	const struct SceneState &from = snapshot.previous;
+	const struct SceneState &to = snapshot.current;
+	struct SceneState state;
+	state.xTrans = from.xTrans + (to.xTrans - from.xTrans) * t;
+	state.yTrans = from.yTrans + (to.yTrans - from.yTrans) * t;
+	state.zTrans = from.zTrans + (to.zTrans - from.zTrans) * t;
+	state.p = from.p + (to.p - from.p) * t;
+	state.q = from.q + (to.q - from.q) * t;
+	state.m = from.m + (to.m - from.m) * t;
+	state.r = from.r + (to.r - from.r) * t;
+	return state;
+}
+
+// The stamps of the keys applied up to the given step, which the frame drawn from that
+// step is the first to show. Keys of later steps wait for a later frame.
+void takeConsumedKeys(unsigned long long step, std::vector<InputStamp> &inputs)
+{
+
+	struct AppliedKey applied;
+	while (appliedKeys.pop(applied))
+		unconsumedKeys.push_back(applied);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < unconsumedKeys.size(); ++i)
 	{
+		if (unconsumedKeys[i].step <= step)
+			inputs.push_back(unconsumedKeys[i].stamp);
+		else
+			unconsumedKeys[kept++] = unconsumedKeys[i];
+	}
+	unconsumedKeys.resize(kept);
+}
 
-		renderRecur(fd, nd->mChildren[n]);
+// Defined with the keyboard callbacks below
+void processKeys(unsigned char key, int xx, int yy);
+void processSpecialKeys(int key, int xx, int yy);
 
+// Give the callbacks the recorded input of the frame about to be drawn
+void replayFrameInput()
+{
+
+	struct InputEvent event;
+	while (sessionPlayer.nextEvent(event))
+	{
+		switch (event.type) {
+			case INPUT_KEY: processKeys((unsigned char)event.a, event.b, event.c); break;
+			case INPUT_SPECIAL_KEY: processSpecialKeys(event.a, event.b, event.c); break;
+			case INPUT_RESHAPE:
+				glutReshapeWindow(event.a, event.b);
+				alterSize(event.a, event.b);
+				break;
+		}
 	}
-	popMat();
+
+	// The update thread is not running during a replay
+	updateScene();
+}
+
+// Wait for the frames still on the GPU, print the input latency, and release the queries
+// and fences. The GL context must be current, so this runs before the main loop is left
+// and when the window is closed, not after glutMainLoop() returns.
+void finishInputLatency()
+{
+
+	if (inputLatencyReleased)
+		return;
+	inputLatency.flush();
+	if (inputLatency.sampleCount() > 0)
+		inputLatency.report(std::cout);
+	inputLatency.release();
+	inputLatencyReleased = true;
+}
+
+// Leave the main loop, with the GL context still current for finishInputLatency()
+void leaveMainLoop()
+{
+
+	finishInputLatency();
+	glutLeaveMainLoop();
+}
+
+// Press the next synthetic key, or once every key has been measured, print the
+// latencies and quit. A key lost on the way only delays the end by a few seconds.
+void runSyntheticInput()
+{
+
+	++syntheticFrame;
+	if (syntheticInputsSent < syntheticInputCount)
+	{
+		if (syntheticFrame % SyntheticInputFrames == 0)
+		{
+			processSpecialKeys(syntheticInputsSent % 2 == 0 ? GLUT_KEY_LEFT : GLUT_KEY_RIGHT, 0, 0);
+			++syntheticInputsSent;
+		}
+		return;
+	}
+
+	if (inputLatency.sampleCount() < (size_t)syntheticInputCount
+		&& syntheticFrame < (syntheticInputCount + 300) * SyntheticInputFrames)
+		return;
+
+	syntheticInputCount = 0;
+	leaveMainLoop();
 }
 
 //===========================================================
@@ -774,10 +1415,18 @@ void scene_Render()
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	translateModel(xTrans, yTrans, zTrans);
+	if (sessionPlayer.isOpen())
+		replayFrameInput();
+
+	// The scene as the update thread last published it
+	const struct SceneSnapshot &snapshot = sceneSnapshots.read();
+	unsigned long long step = snapshot.step;
+	struct SceneState state = interpolateSnapshot(snapshot);
+
+	translateModel(state.xTrans, state.yTrans, state.zTrans);
 
 	// set camera matrix
-	setViewCamera(cameraX, cameraY, cameraZ, xTrans, yTrans, zTrans);
+	setViewCamera(cameraX, cameraY, cameraZ, state.xTrans, state.yTrans, state.zTrans);
 
 	// set the model matrix to the identity Matrix
 	setMatrixIdentity(matrixModelX, 4);
@@ -786,19 +1435,47 @@ void scene_Render()
 	scaleModel(modelWindowSize, modelWindowSize, modelWindowSize);
 
 	// rotating the model
-	rotateModel(p, 1.0f, 0.0f, 0.0f); //about the x-axis
-	rotateModel(q, 0.0f, 1.0f, 0.0f); //about the y-axis
-	rotateModel(m, 0.0f, 0.0f, 1.0f); //about the z-axis
+	rotateModel(state.p, 1.0f, 0.0f, 0.0f); //about the x-axis
+	rotateModel(state.q, 0.0f, 1.0f, 0.0f); //about the y-axis
+	rotateModel(state.m, 0.0f, 0.0f, 1.0f); //about the z-axis
 
 	// use shader
 	glUseProgram(prog);
 
 	glUniform1i(unitText, 0);  // 0 means Texture Unit 0. It tells fragment shader to retrieve texture from Texture Unit 0. 
 
-	renderRecur(sceneOnScreen, sceneOnScreen->mRootNode);
+	// Draw the meshes of all the nodes with the recorded draw calls. The next frame is
+	// recorded from the newest state, which the interpolation reaches a step from now.
+	renderNodes(snapshot.current);
+
+	// The time of the replayed frame, then its image if the hashes are written. The
+	// readback waits for the GPU, so it is left out of the frame time.
+	if (sessionPlayer.isOpen())
+	{
+		sessionPlayer.frameDrawn();
+		if (replayFramesFile)
+			sessionPlayer.frameHashed(framebufferHash());
+	}
 
 	// swap buffers
 	glutSwapBuffers();
+	sessionRecorder.frameDrawn();
+
+	// The next frame was recorded while this one was drawn
+	scenePipeline.finishRecording(jobSystem);
+
+	// Tag the frame with the keys it is the first to show, and collect the latency of
+	// the frames the GPU has finished
+	std::vector<InputStamp> inputs;
+	takeConsumedKeys(step, inputs);
+	inputLatency.frameSubmitted(inputs);
+	inputLatency.poll();
+
+	if (syntheticInputCount > 0)
+		runSyntheticInput();
+
+	if (sessionPlayer.finished())
+		leaveMainLoop();
 
 	// increase the rotation angle
 	/*p++;
@@ -812,35 +1489,28 @@ void scene_Render()
 // Events from the Keyboard
 //
 
-void processKeys(unsigned char key, int xx, int yy)
+// Pass a key to the update thread, which changes the scene at its next step
+void queueKey(int key, bool special)
 {
-	double f = .50;
-	switch (key) {
-		case 27: glutLeaveMainLoop(); break;
 
-		case 'h': r += 0.1f; break;
+	struct KeyEvent event = { key, special, std::chrono::steady_clock::now() };
+	if (!keyEvents.push(event))
+		fprintf(stderr, "Key queue full, key %d dropped\n", key);
+}
 
-		case 'X': xTrans -= f; 
-			break;
-		case 'x': xTrans += f; 
-			break;
+void processKeys(unsigned char key, int xx, int yy)
+{
+	sessionRecorder.record(INPUT_KEY, key, xx, yy);
 
-		case 'Y': yTrans -= f; 
-			break;
-		case 'y': yTrans += f; 
-			break;
+	switch (key) {
+		case 27: leaveMainLoop(); return;
 
-		case 'Z': zTrans -= f; 
-			break;
-		case 'z': zTrans += f; 
-			break; 
+		case 'l':	// Prints the input latency measured so far
+			inputLatency.poll();
+			inputLatency.report(std::cout);
+			return;
 
-		case 'R': ++m;//++m; 
-			break; // Roll
-		
 		case 'o':	// Default, resets the translations vies from starting view
-			xTrans = yTrans = 0.0f;
-			zTrans = 0.0f;
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
 			gluLookAt(cameraX, cameraY, cameraZ, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
@@ -848,6 +1518,8 @@ void processKeys(unsigned char key, int xx, int yy)
 
 	} 
 
+	queueKey(key, false);
+
 	// Generate a display event, which forces Freeglut to call display(). 
 	glutPostRedisplay();
 
@@ -856,16 +1528,11 @@ void processKeys(unsigned char key, int xx, int yy)
 void processSpecialKeys(int key, int xx, int yy)
 {
 
-	switch (key) {
-
-	    case GLUT_KEY_LEFT: --q; break; // rotate clockwisen y-axis
-		case GLUT_KEY_RIGHT: ++q; break; // rotate counterclockwise y-axis
+	sessionRecorder.record(INPUT_SPECIAL_KEY, key, xx, yy);
 
-		case GLUT_KEY_UP: --p; break; // rotate clockwise x-axis
-		case GLUT_KEY_DOWN: ++p; break; // rotate counterclockwise x-axis
+	switch (key) {
 
 		case GLUT_KEY_HOME:	// Default, resets the translations vies from starting view
-			q = p = 0.0f;
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
 			gluLookAt(cameraX, cameraY, cameraZ, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
@@ -874,6 +1541,8 @@ void processSpecialKeys(int key, int xx, int yy)
 		
 	}
 
+	queueKey(key, true);
+
 	// Generate a display event, which forces Freeglut to call display(). 
 	glutPostRedisplay();
 }
@@ -881,39 +1550,62 @@ void processSpecialKeys(int key, int xx, int yy)
 GLuint shaderConfig()
 {
 
-	char *vertshade = NULL, *fragshade = NULL, *fragshade2 = NULL;
+	char *vertshade = NULL, *fragshade = NULL;
 
-	GLuint p, v, f;
+	GLuint p, v = 0, f = 0;
 
-	v = glCreateShader(GL_VERTEX_SHADER);
-	f = glCreateShader(GL_FRAGMENT_SHADER);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
 	vertshade = textFileRead(vertexFileName);
 	fragshade = textFileRead(fragmentFileName);
 
-	const char * vv = vertshade;
-	const char * ff = fragshade;
+	// The attribute and output locations are fixed at link time, so they are part of the key
+	char linkState[128];
+	sprintf(linkState, "Output=0 Position=%u Normal=%u Text Coordinate=%u", vertLoc, normLoc, coorLoc);
+	std::string programKey = programCacheKey(vertshade, fragshade, linkState);
 
-	glShaderSource(v, 1, &vv, NULL);
-	glShaderSource(f, 1, &ff, NULL);
+	p = loadCachedProgram(programKey);
 
-	free(vertshade); free(fragshade);
+	if (p == 0)
+	{
+		v = glCreateShader(GL_VERTEX_SHADER);
+		f = glCreateShader(GL_FRAGMENT_SHADER);
+
+		const char * vv = vertshade;
+		const char * ff = fragshade;
+
+		glShaderSource(v, 1, &vv, NULL);
+		glShaderSource(f, 1, &ff, NULL);
 
-	glCompileShader(v);
-	glCompileShader(f);
+		glCompileShader(v);
+		glCompileShader(f);
 
-	p = glCreateProgram();
-	glAttachShader(p, v);
-	glAttachShader(p, f);
+		p = glCreateProgram();
+		glAttachShader(p, v);
+		glAttachShader(p, f);
 
-	glBindFragDataLocation(p, 0, "Output");
+		glBindFragDataLocation(p, 0, "Output");
 
-	glBindAttribLocation(p, vertLoc, "Position");
-	glBindAttribLocation(p, normLoc, "Normal");
-	glBindAttribLocation(p, coorLoc, "Text Coordinate");
+		glBindAttribLocation(p, vertLoc, "Position");
+		glBindAttribLocation(p, normLoc, "Normal");
+		glBindAttribLocation(p, coorLoc, "Text Coordinate");
 
-	glLinkProgram(p);
-	glValidateProgram(p);
+		prepareProgramForCache(p);
+		glLinkProgram(p);
+		glValidateProgram(p);
+
+		storeCachedProgram(p, programKey);
+
+		printf("Shader program compiled and linked in %.3f ms\n",
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	else
+	{
+		printf("Shader program loaded from the program cache in %.3f ms\n",
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	free(vertshade); free(fragshade);
 
 	prog = p;
 	vertexShader = v;
@@ -921,9 +1613,20 @@ GLuint shaderConfig()
 
 	GLuint k = glGetUniformBlockIndex(p, "Matrices");
 	glUniformBlockBinding(p, k, uniLocMatrix);
-	glUniformBlockBinding(p, glGetUniformBlockIndex(p, "Material"), uniLocMaterial);
+	glUniformBlockBinding(p, glGetUniformBlockIndex(p, "Materials"), uniLocMaterial);
 
 	unitText = glGetUniformLocation(p, "unitText");
+	uniMaterialID = glGetUniformLocation(p, "materialID");
+
+	// A uniform block that does not match its C struct would draw with wrong matrices
+	// or materials, so stop here instead.
+	if (!validateUniformBlock(p, "Matrices", "Matrices", MatricesUniBufferSize,
+			matricesFields, sizeof(matricesFields) / sizeof(matricesFields[0]))
+		|| !validateUniformBlock(p, "Materials", "MiMaterial table", MaterialsUniBufferSize,
+			materialFields, sizeof(materialFields) / sizeof(materialFields[0])))
+	{
+		exit(EXIT_FAILURE);
+	}
 
 	return(p);
 }
@@ -936,6 +1639,15 @@ GLuint shaderConfig()
 
 int init()
 {
+	// One worker thread per core, less the main thread, which helps while it waits
+	jobSystem.start(0);
+
+	// Publish the initial state before scene_Render() reads it, then start the updates.
+	// A replay steps the scene from scene_Render() instead.
+	updateScene();
+	if (!sessionPlayer.isOpen())
+		updateThread.start(UpdateStepSeconds, updateScene);
+
 	if (!ImportFrom3DFile(modelFile))
 		return(0);
 
@@ -948,6 +1660,7 @@ int init()
 
 	prog = shaderConfig();
 	generateVAOandUBuffer(sceneOnScreen);
+	buildTransformGraph(sceneOnScreen);
 
 	glEnable(GL_DEPTH_TEST); // Enable depth test
 	glClearColor(0.0f, 0.0f, 1.0f, 1.0f); // Black Color
@@ -979,6 +1692,20 @@ int main(int argc, char **argv)
 	//  GLUT initialization
 	glutInit(&argc, argv);
 
+	// --synthetic-input N measures the input latency of N generated keys, then quits.
+	// --record FILE, --replay FILE, and --replay-frames FILE are the input sessions.
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "--synthetic-input") == 0)
+			syntheticInputCount = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--record") == 0 && !sessionRecorder.open(argv[i + 1]))
+			fprintf(stderr, "Cannot write the input session %s\n", argv[i + 1]);
+		else if (strcmp(argv[i], "--replay") == 0 && !sessionPlayer.open(argv[i + 1]))
+			fprintf(stderr, "Cannot read the input session %s\n", argv[i + 1]);
+		else if (strcmp(argv[i], "--replay-frames") == 0)
+			replayFramesFile = argv[i + 1];
+	}
+
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA | GLUT_MULTISAMPLE);
 	glutInitWindowPosition(100, 100);
 	glutInitWindowSize(1024, 768); // Windows height and width
@@ -993,6 +1720,9 @@ int main(int argc, char **argv)
 	glutKeyboardFunc(processKeys);
 	glutSpecialFunc(processSpecialKeys);
 
+	// Closing the window destroys the GL context, so the latency queries are released first
+	glutCloseFunc(finishInputLatency);
+
 	//glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 	// Register a debug message callback function. 
 	//glDebugMessageCallback((GLDEBUGPROC)openGLDebugCallback, nullptr);
@@ -1014,8 +1744,21 @@ int main(int argc, char **argv)
 	// GLUT main loop
 	glutMainLoop();
 
+	updateThread.stop();
+	jobSystem.stop();
+
+	// The input latency was reported while the context was current (finishInputLatency())
+	sessionRecorder.close();
+	if (sessionPlayer.isOpen())
+	{
+		sessionPlayer.report(std::cout);
+		if (replayFramesFile && !sessionPlayer.writeFrames(replayFramesFile))
+			fprintf(stderr, "Cannot write the replayed frames to %s\n", replayFramesFile);
+	}
+
 	// delete VBO
 	glDeleteBuffers(1, &uniBufferMatix);
+	glDeleteBuffers(1, &uniBufferMaterials);
 
 	return(0);
 }
@@ -0,0 +1,168 @@
+/* This is a utility program that runs the simulation of a scene on its own thread at a fixed
+timestep, apart from the rendering. The input callbacks pass events to the update thread
+through a queue, and the update thread publishes a snapshot of the scene after every step
+through a triple buffer. Neither side ever waits for the other. The following classes
+are provided.
+
+// A queue between one producer thread and one consumer thread. Both ends are lock-free.
+template <typename T, unsigned int Capacity>
+class SpscQueue {
+	bool push(const T &item); // false if the queue is full (the item is dropped)
+	bool pop(T &item);        // false if the queue is empty
+};
+
+// Three copies of a value: one written by the producer, one read by the consumer, and one
+// in between. publish() hands the written copy over and read() takes the newest one, so
+// the producer never overwrites the copy being read and the consumer never sees a copy
+// that is half written. A slow reader skips snapshots instead of delaying the writer.
+template <typename T>
+class TripleBuffer {
+	T &writeBuffer();     // the copy to fill before publish()
+	void publish();
+	const T &read();      // the newest published copy (the last one read if none is newer)
+};
+
+Publish a first copy before the consumer starts reading.
+
+// Calls stepFunction() every stepSeconds on its own thread until stop(). The steps keep to the
+// clock: a step that is late does not delay the ones after it.
+class FixedUpdateThread {
+	void start(double stepSeconds, const std::function<void()> &stepFunction);
+	void stop();
+	double stepSeconds() const;
+};
+
+The render side interpolates between the last two states of a snapshot (see
+interpolationFactor()), so the motion is smooth whatever the frame rate, and a frame
+that takes long delays neither the input nor the simulation.
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+template <typename T, unsigned int Capacity>
+class SpscQueue {
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	//------------------------------------------------
+	// Called by the producer only.
+	bool push(const T &item) {
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+		items[t % Capacity] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	//------------------------------------------------
+	// Called by the consumer only.
+	bool pop(T &item) {
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[h % Capacity];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items[Capacity];
+	std::atomic<unsigned int> head, tail; // items popped and pushed so far
+};
+
+// The slot index in the low bits of TripleBuffer::middle, and the flag that marks a copy
+// published but not read yet.
+const unsigned int TRIPLE_BUFFER_INDEX_MASK = 3;
+const unsigned int TRIPLE_BUFFER_FRESH = 4;
+
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : middle(1), back(0), front(2) {}
+
+	T &writeBuffer() { return slots[back]; }
+
+	//------------------------------------------------
+	// Swap the written copy with the one in between, and mark it as new for the reader.
+	void publish() {
+		back = middle.exchange(back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX_MASK;
+	}
+
+	//------------------------------------------------
+	// Swap the copy in between with the one being read if it is new.
+	const T &read() {
+		if (middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX_MASK;
+		}
+		return slots[front];
+	}
+
+private:
+	T slots[3];
+	std::atomic<unsigned int> middle;
+	unsigned int back;  // owned by the producer
+	unsigned int front; // owned by the consumer
+};
+
+class FixedUpdateThread {
+public:
+	FixedUpdateThread() : running(false), step(0.0) {}
+
+	~FixedUpdateThread() { stop(); }
+
+	//------------------------------------------------
+	void start(double stepSeconds, const std::function<void()> &stepFunction) {
+		stop();
+		step = stepSeconds;
+		running.store(true);
+		thread = std::thread([this, stepFunction]() {
+			std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+			std::chrono::steady_clock::duration period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(step));
+			while (running.load(std::memory_order_acquire)) {
+				stepFunction();
+				next += period;
+
+				// After a long stall, skip the missed steps instead of running them back to back
+				std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				if (now - next > period * 4) {
+					next = now;
+				}
+				std::this_thread::sleep_until(next);
+			}
+		});
+	}
+
+	//------------------------------------------------
+	void stop() {
+		running.store(false, std::memory_order_release);
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	double stepSeconds() const { return step; }
+
+private:
+	std::atomic<bool> running;
+	double step;
+	std::thread thread;
+};
+
+//------------------------------------------------
+// How far the render time is between the two states of a snapshot taken at stepTime:
+// 0 at stepTime, 1 a step later and after. The render shows the previous state at
+// stepTime and reaches the latest one a step later, so it runs one step behind the
+// simulation and always has two states to interpolate between.
+inline float interpolationFactor(std::chrono::steady_clock::time_point stepTime, double stepSeconds) {
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepTime).count();
+	double t = stepSeconds > 0.0 ? elapsed / stepSeconds : 1.0;
+	return t < 0.0 ? 0.0f : (t > 1.0 ? 1.0f : (float)t);
+}
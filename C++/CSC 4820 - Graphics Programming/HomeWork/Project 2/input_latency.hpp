@@ -0,0 +1,208 @@
+/* This is a utility program that measures the latency from an input event to the frame that
+shows it. The input callback stamps each event with the time it arrived, and the render
+loop hands the stamps of the events a frame consumed to frameSubmitted() right after the
+swap. A fence and a GL_TIMESTAMP query follow the frame into the command stream, so the
+time the GPU finished the frame is known without waiting for it. Include it after
+GL/glew.h. The following struct and class are provided.
+
+// One input event consumed by a frame: when it arrived and when the scene applied it.
+struct InputStamp {
+	std::chrono::steady_clock::time_point arrived;
+	std::chrono::steady_clock::time_point applied;
+};
+
+class InputLatencyMonitor {
+	// Call right after the swap of a frame that consumed input. Makes a fence and a
+	// timestamp query; returns at once.
+	void frameSubmitted(const std::vector<InputStamp> &inputs);
+
+	// Resolve the frames the GPU has finished. Never waits; call once per frame.
+	void poll();
+
+	// Wait for every submitted frame, e.g. before the final report.
+	void flush();
+
+	size_t sampleCount() const;
+	size_t pendingFrames() const;
+
+	// Percentiles (50, 90, 99, max) of the latency from input to each stage, in ms.
+	void report(std::ostream &out) const;
+	void clear();
+
+	// Release the queries and fences. The destructor does not touch OpenGL, since the
+	// context may already be gone.
+	void release();
+};
+
+The stages are:
+	applied    the scene state changed (the wait for the next update step)
+	submitted  the swap of the first frame drawn from that state returned
+	gpu done   the GPU finished that frame, from the GL_TIMESTAMP query converted to
+	           the CPU clock (from the fence if timer queries are missing)
+The last stage is as close to the photon as OpenGL can see; scan out and the display
+add up to one refresh interval more.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+struct InputStamp {
+	std::chrono::steady_clock::time_point arrived;
+	std::chrono::steady_clock::time_point applied;
+};
+
+// The latencies of one input event, in milliseconds.
+struct InputLatencySample {
+	double applied, submitted, gpuDone;
+};
+
+class InputLatencyMonitor {
+public:
+	InputLatencyMonitor() {}
+
+	//------------------------------------------------
+	void frameSubmitted(const std::vector<InputStamp> &inputs) {
+		if (inputs.empty()) {
+			return;
+		}
+		PendingFrame frame;
+		frame.inputs = inputs;
+		frame.submitted = std::chrono::steady_clock::now();
+		frame.query = 0;
+		if (GLEW_ARB_timer_query) {
+			if (freeQueries.empty()) {
+				GLuint query;
+				glGenQueries(1, &query);
+				freeQueries.push_back(query);
+			}
+			frame.query = freeQueries.back();
+			freeQueries.pop_back();
+			glQueryCounter(frame.query, GL_TIMESTAMP);
+		}
+		frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		pending.push_back(frame);
+	}
+
+	//------------------------------------------------
+	void poll() {
+		resolve(false);
+	}
+
+	//------------------------------------------------
+	void flush() {
+		resolve(true);
+	}
+
+	size_t sampleCount() const { return samples.size(); }
+
+	size_t pendingFrames() const { return pending.size(); }
+
+	//------------------------------------------------
+	void report(std::ostream &out) const {
+		out << "Input latency, " << samples.size() << " events:" << std::endl;
+		if (samples.empty()) {
+			return;
+		}
+		std::vector<double> applied, submitted, gpuDone;
+		for (size_t i = 0; i < samples.size(); i++) {
+			applied.push_back(samples[i].applied);
+			submitted.push_back(samples[i].submitted);
+			gpuDone.push_back(samples[i].gpuDone);
+		}
+		out << "    " << std::setw(10) << "stage" << std::setw(10) << "p50" << std::setw(10) << "p90"
+			<< std::setw(10) << "p99" << std::setw(10) << "max" << "  (ms)" << std::endl;
+		reportStage(out, "applied", applied);
+		reportStage(out, "submitted", submitted);
+		reportStage(out, "gpu done", gpuDone);
+	}
+
+	void clear() { samples.clear(); }
+
+	//------------------------------------------------
+	void release() {
+		for (size_t i = 0; i < pending.size(); i++) {
+			glDeleteSync(pending[i].fence);
+			if (pending[i].query != 0) {
+				freeQueries.push_back(pending[i].query);
+			}
+		}
+		pending.clear();
+		if (!freeQueries.empty()) {
+			glDeleteQueries((GLsizei)freeQueries.size(), &freeQueries[0]);
+			freeQueries.clear();
+		}
+	}
+
+private:
+	struct PendingFrame {
+		std::vector<InputStamp> inputs;
+		std::chrono::steady_clock::time_point submitted;
+		GLsync fence;
+		GLuint query; // 0 without timer queries
+	};
+
+	//------------------------------------------------
+	// Turn the finished frames at the front of the queue into samples. The frames finish
+	// in order, so the first unfinished one ends the loop.
+	void resolve(bool wait) {
+		while (!pending.empty()) {
+			PendingFrame &frame = pending.front();
+			GLenum status = glClientWaitSync(frame.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+				wait ? 1000000000ull : 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				return;
+			}
+			std::chrono::steady_clock::time_point done = std::chrono::steady_clock::now();
+
+			// The GPU clock and the CPU clock are paired now; the timestamp of the frame
+			// is moved to the CPU clock by its distance from the GPU time now.
+			if (frame.query != 0) {
+				GLuint64 frameTime = 0;
+				GLint64 gpuNow = 0;
+				glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &frameTime);
+				glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+				done = std::chrono::steady_clock::now() -
+					std::chrono::nanoseconds(std::max((GLint64)0, gpuNow - (GLint64)frameTime));
+				freeQueries.push_back(frame.query);
+			}
+			glDeleteSync(frame.fence);
+
+			for (size_t i = 0; i < frame.inputs.size(); i++) {
+				const InputStamp &input = frame.inputs[i];
+				InputLatencySample sample;
+				sample.applied = milliseconds(input.applied - input.arrived);
+				sample.submitted = milliseconds(frame.submitted - input.arrived);
+				sample.gpuDone = std::max(sample.submitted, milliseconds(done - input.arrived));
+				samples.push_back(sample);
+			}
+			pending.erase(pending.begin());
+		}
+	}
+
+	static double milliseconds(std::chrono::steady_clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	//------------------------------------------------
+	static void reportStage(std::ostream &out, const char *name, std::vector<double> &values) {
+		std::sort(values.begin(), values.end());
+		out << "    " << std::setw(10) << name << std::fixed << std::setprecision(2)
+			<< std::setw(10) << percentile(values, 50.0) << std::setw(10) << percentile(values, 90.0)
+			<< std::setw(10) << percentile(values, 99.0) << std::setw(10) << values.back() << std::endl;
+	}
+
+	// Nearest-rank percentile of sorted values.
+	static double percentile(const std::vector<double> &sorted, double p) {
+		size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+		rank = std::min(std::max(rank, (size_t)1), sorted.size());
+		return sorted[rank - 1];
+	}
+
+	std::vector<PendingFrame> pending;
+	std::vector<GLuint> freeQueries;
+	std::vector<InputLatencySample> samples;
+};
@@ -0,0 +1,21 @@
+#version 130
+
+// Draws the bounding box of a mesh for its occlusion query. The box is a triangle strip 
+// of 14 vertices made from gl_VertexID, so no vertex buffer is needed: 
+// glDrawArrays(GL_TRIANGLE_STRIP, 0, 14). Each bit of the three masks is one corner 
+// coordinate of one strip vertex. 
+
+uniform mat4 mvpMatrix; // model_view_project matrix
+uniform vec3 boxMin; // model space bounding box of the mesh
+uniform vec3 boxMax;
+
+// The corners on the surface of a mesh must get the same depth as the mesh itself 
+// (see Rucker_vertex_proj3.glsl), or the depth test of the query is decided by rounding. 
+invariant gl_Position;
+
+void main() 
+{
+    int bit = 1 << gl_VertexID;
+    vec3 corner = vec3((0x287a & bit) != 0, (0x02af & bit) != 0, (0x31e3 & bit) != 0);
+    gl_Position = mvpMatrix * vec4(mix(boxMin, boxMax, corner), 1.0);
+}
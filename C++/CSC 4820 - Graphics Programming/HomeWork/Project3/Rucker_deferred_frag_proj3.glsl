@@ -0,0 +1,153 @@
+#version 330
+
+// The lighting pass of the deferred renderer. It runs once per pixel, reads the surface 
+// from the G-buffer written by Rucker_gbuffer_frag_proj3.glsl, and applies the same 
+// lighting as Rucker_frag_proj3.glsl: the light source in the uniform block and the 
+// clustered point lights. 
+
+// The G-buffer
+uniform sampler2D gNormal; // xyz: eye space normal, w: shininess
+uniform sampler2D gDiffuse;
+uniform sampler2D gSpecular;
+uniform sampler2D gAmbient;
+uniform sampler2D gDepth;
+
+// For rebuilding the eye space position from the depth buffer
+uniform mat4 inverseProjMatrix;
+uniform vec2 pixelSize; // 1 / window size
+
+// Uniform block for the light source properties
+layout (std140) uniform LightSourceProp {
+	// Light source position in eye space (i.e. eye is at (0, 0, 0))
+	uniform vec4 lightSourcePosition;
+	
+	uniform vec4 diffuseLightIntensity;
+	uniform vec4 specularLightIntensity;
+	uniform vec4 ambientLightIntensity;
+	
+	// for calculating the light attenuation 
+	uniform float constantAttenuation;
+	uniform float linearAttenuation;
+	uniform float quadraticAttenuation;
+	
+	// Spotlight direction
+	uniform vec3 spotDirection;
+
+	// Spotlight cutoff angle
+	uniform float spotCutoff;
+};
+
+// Clustered point lights (see light_clusters.hpp and Rucker_frag_proj3.glsl)
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterDimensions;
+uniform vec2 clusterTileScale; // clusters per pixel in x and y
+uniform vec2 clusterSliceParameters; // slice = log(depth) * x + y
+
+// Shadow map of the spotlight (see Rucker_frag_proj3.glsl)
+uniform sampler2DShadow shadowMap;
+uniform mat4 shadowMatrix;
+uniform bool spotlightShadows;
+
+out vec4 color;
+
+// How much of the spotlight reaches the eye space position p: 0 outside its cone and in
+// shadow, 1 in full light. 3x3 PCF: each lookup already blends the comparisons of the
+// 4 nearest texels, so the 9 lookups soften the shadow edge over about 4 texels.
+float spotlightVisibility(vec3 p) {
+    if (!spotlightShadows) {
+        return 1.0;
+    }
+
+    // The shadow map is square, so its corners reach past the round cone. spotCutoff is
+    // the half angle of the cone in radians.
+    vec3 toPixel = normalize(p - lightSourcePosition.xyz);
+    if (dot(toPixel, normalize(spotDirection)) < cos(spotCutoff)) {
+        return 0.0; // outside the cone of the light
+    }
+
+    vec4 shadowPosition = shadowMatrix * vec4(p, 1.0);
+    if (shadowPosition.w <= 0.0) {
+        return 0.0; // behind the light
+    }
+    vec3 texel = shadowPosition.xyz / shadowPosition.w;
+    if (any(greaterThan(abs(texel.xy * 2.0 - 1.0), vec2(1.0)))) {
+        return 0.0; // outside the shadow map
+    }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    float visibility = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            visibility += texture(shadowMap, vec3(texel.xy + vec2(x, y) * texelSize, texel.z));
+        }
+    }
+    return visibility / 9.0;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) {
+        discard; // nothing was drawn on this pixel
+    }
+
+    // Rebuild the eye space position of the pixel
+    vec4 ndcPosition = vec4(gl_FragCoord.xy * pixelSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 eyePosition = inverseProjMatrix * ndcPosition;
+    vec3 v = eyePosition.xyz / eyePosition.w;
+
+    vec4 normalShininess = texelFetch(gNormal, pixel, 0);
+    vec3 N = normalShininess.xyz;
+    float shininess = normalShininess.w;
+    vec4 Kdiffuse = texelFetch(gDiffuse, pixel, 0);
+    vec4 Kspecular = texelFetch(gSpecular, pixel, 0);
+    vec4 Kambient = texelFetch(gAmbient, pixel, 0);
+
+    // The light source in the uniform block (see Rucker_frag_proj3.glsl)
+    vec3 lightVector = normalize(lightSourcePosition.xyz - v);
+
+    float distance = length(lightSourcePosition.xyz - v);
+    float attenuation = 1.0 / (constantAttenuation + (linearAttenuation * distance) 
+        +(quadraticAttenuation * distance * distance));
+
+    float NdotL = max(dot(N,lightVector), 0.0);
+    vec4 diffuseColor = Kdiffuse * diffuseLightIntensity * NdotL;
+
+    vec3 E = normalize(-v); // Eye vector. We are in Eye Coordinates, so EyePos is (0,0,0)  
+    vec3 R = normalize(-reflect(lightVector,N)); // light reflection vector
+    float RdotE = max(dot(R,E),0.0);
+    vec4 specularColor = Kspecular * specularLightIntensity * pow(RdotE,shininess);
+
+    vec4 ambientColor = Kambient * ambientLightIntensity;
+
+    attenuation *= spotlightVisibility(v);
+
+    color = ambientColor + attenuation * (diffuseColor + specularColor);
+
+    // The point lights in the cluster of this pixel
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy * clusterTileScale),
+        int(log(-v.z) * clusterSliceParameters.x + clusterSliceParameters.y));
+    cluster = clamp(cluster, ivec3(0), clusterDimensions - 1);
+    int clusterIndex = cluster.x + clusterDimensions.x * (cluster.y + clusterDimensions.y * cluster.z);
+
+    uvec2 range = texelFetch(clusterRanges, clusterIndex).rg;
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, 2 * light);
+        vec4 lightColor = vec4(texelFetch(lightData, 2 * light + 1).rgb, 0.0);
+
+        vec3 L = positionRadius.xyz - v;
+        float lightDistance = length(L);
+        L /= lightDistance;
+
+        // Inverse square falloff, smoothly windowed to zero at the radius of the light
+        float window = clamp(1.0 - pow(lightDistance / positionRadius.w, 4.0), 0.0, 1.0);
+        float lightAttenuation = window * window / (1.0 + lightDistance * lightDistance);
+
+        vec3 lightReflection = normalize(-reflect(L, N));
+        color += Kdiffuse * lightColor * (max(dot(N, L), 0.0) * lightAttenuation);
+        color += Kspecular * lightColor * (pow(max(dot(lightReflection, E), 0.0), shininess) * lightAttenuation);
+    }
+}
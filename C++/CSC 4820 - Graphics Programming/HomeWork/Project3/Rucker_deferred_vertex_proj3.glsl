@@ -0,0 +1,10 @@
+#version 330
+
+// The lighting pass of the deferred renderer draws one triangle that covers the window. 
+// It is drawn with glDrawArrays(GL_TRIANGLES, 0, 3) and no vertex attributes; 
+// the corners (-1, -1), (3, -1), and (-1, 3) are made from gl_VertexID. 
+void main() 
+{
+    vec2 position = vec2((gl_VertexID & 1) * 4.0 - 1.0, (gl_VertexID >> 1) * 4.0 - 1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+}
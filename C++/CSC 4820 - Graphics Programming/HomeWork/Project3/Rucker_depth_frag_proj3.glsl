@@ -0,0 +1,7 @@
+#version 130
+
+// Fragment shader of the depth pre-pass. Color writes are turned off during the pre-pass; 
+// only the depth of the fragment is kept. 
+void main() 
+{
+}
@@ -0,0 +1,23 @@
+#version 130
+
+// Vertex shader of the depth pre-pass. It reads only the vertex positions and writes 
+// only depth, so the shading pass that follows can test with GL_EQUAL and shade each 
+// visible pixel once. 
+
+in vec3 vPos;
+
+uniform mat4 mvpMatrix; // model_view_project matrix
+
+// Compressed vertex positions (see Rucker_vertex_proj3.glsl)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// gl_Position is computed exactly as in Rucker_vertex_proj3.glsl. Both shaders declare it 
+// invariant, so the two passes produce the same depth values. 
+invariant gl_Position;
+
+void main() 
+{
+    vec4 position = vec4(positionOffset + vPos.xyz * positionScale, 1.0);
+    gl_Position = mvpMatrix * position;
+}
@@ -32,8 +32,87 @@ layout (std140) uniform materialProp {
 	uniform float shininess;
 };
 
+// Clustered point lights (see light_clusters.hpp). The view frustum is divided into
+// clusters, and each cluster has a list of the point lights that reach it.
+// lightData: 2 texels per light; xyz = eye space position, w = radius; rgb = color
+// clusterRanges: 1 texel per cluster; r = first entry in lightIndices, g = light count
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterDimensions;
+uniform vec2 clusterTileScale; // clusters per pixel in x and y
+uniform vec2 clusterSliceParameters; // slice = log(depth) * x + y
+
+// Shadow map of the spotlight (lightSource1). shadowMatrix takes an eye space position to
+// shadow map texture coordinates and depth. When spotlightShadows is false, the light
+// shines everywhere, as a point light.
+uniform sampler2DShadow shadowMap;
+uniform mat4 shadowMatrix;
+uniform bool spotlightShadows;
+
 out vec4 color;
 
+// How much of the spotlight reaches the eye space position p: 0 outside its cone and in
+// shadow, 1 in full light. 3x3 PCF: each lookup already blends the comparisons of the
+// 4 nearest texels, so the 9 lookups soften the shadow edge over about 4 texels.
+float spotlightVisibility(vec3 p) {
+    if (!spotlightShadows) {
+        return 1.0;
+    }
+
+    // The shadow map is square, so its corners reach past the round cone. spotCutoff is
+    // the half angle of the cone in radians.
+    vec3 toPixel = normalize(p - lightSourcePosition.xyz);
+    if (dot(toPixel, normalize(spotDirection)) < cos(spotCutoff)) {
+        return 0.0; // outside the cone of the light
+    }
+
+    vec4 shadowPosition = shadowMatrix * vec4(p, 1.0);
+    if (shadowPosition.w <= 0.0) {
+        return 0.0; // behind the light
+    }
+    vec3 texel = shadowPosition.xyz / shadowPosition.w;
+    if (any(greaterThan(abs(texel.xy * 2.0 - 1.0), vec2(1.0)))) {
+        return 0.0; // outside the shadow map
+    }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    float visibility = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            visibility += texture(shadowMap, vec3(texel.xy + vec2(x, y) * texelSize, texel.z));
+        }
+    }
+    return visibility / 9.0;
+}
+
+// Add the contribution of the point lights in the cluster of this pixel.
+void addClusteredLights(vec3 normal, vec3 E, inout vec4 diffuseColor, inout vec4 specularColor) {
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy * clusterTileScale),
+        int(log(-v.z) * clusterSliceParameters.x + clusterSliceParameters.y));
+    cluster = clamp(cluster, ivec3(0), clusterDimensions - 1);
+    int clusterIndex = cluster.x + clusterDimensions.x * (cluster.y + clusterDimensions.y * cluster.z);
+
+    uvec2 range = texelFetch(clusterRanges, clusterIndex).rg;
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, 2 * light);
+        vec4 lightColor = vec4(texelFetch(lightData, 2 * light + 1).rgb, 0.0);
+
+        vec3 L = positionRadius.xyz - v;
+        float distance = length(L);
+        L /= distance;
+
+        // Inverse square falloff, smoothly windowed to zero at the radius of the light
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (1.0 + distance * distance);
+
+        vec3 R = normalize(-reflect(L, normal));
+        diffuseColor += Kdiffuse * lightColor * (max(dot(normal, L), 0.0) * attenuation);
+        specularColor += Kspecular * lightColor * (pow(max(dot(R, E), 0.0), shininess) * attenuation);
+    }
+}
+
 // This fragment shader is an example of per-pixel lighting.
 void main() {
 
@@ -77,6 +156,15 @@ void main() {
    // ambient color
    vec4 ambientColor = Kambient * ambientLightIntensity;
 
-   color = ambientColor + attenuation * (diffuseColor + specularColor);      
+   // the spotlight only reaches the pixel inside its cone and outside the shadows
+   attenuation *= spotlightVisibility(v);
+
+   color = ambientColor + attenuation * (diffuseColor + specularColor);
+
+   // the point lights
+   vec4 clusterDiffuse = vec4(0.0);
+   vec4 clusterSpecular = vec4(0.0);
+   addClusteredLights(N, E, clusterDiffuse, clusterSpecular);
+   color += clusterDiffuse + clusterSpecular;
 }
 
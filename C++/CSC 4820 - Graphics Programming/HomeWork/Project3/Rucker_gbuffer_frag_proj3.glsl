@@ -0,0 +1,27 @@
+#version 330
+
+in vec3 N; // interpolated normal for the pixel
+in vec3 v; // interpolated position for the pixel 
+
+// Uniform block for surface material properties
+layout (std140) uniform materialProp {
+	uniform vec4 Kambient;
+	uniform vec4 Kdiffuse;
+	uniform vec4 Kspecular;
+	uniform float shininess;
+};
+
+// The G-buffer of the deferred renderer. No lighting is done here; the lighting pass in 
+// Rucker_deferred_frag_proj3.glsl reads these values and rebuilds the eye space position 
+// from the depth buffer. 
+layout (location = 0) out vec4 gNormal; // xyz: eye space normal, w: shininess
+layout (location = 1) out vec4 gDiffuse; // Kdiffuse
+layout (location = 2) out vec4 gSpecular; // Kspecular
+layout (location = 3) out vec4 gAmbient; // Kambient
+
+void main() {
+    gNormal = vec4(N, shininess);
+    gDiffuse = Kdiffuse;
+    gSpecular = Kspecular;
+    gAmbient = Kambient;
+}
@@ -7,20 +7,43 @@ uniform mat4 mvpMatrix; // model_view_project matrix
 uniform mat4 mvMatrix;	// model view matrix
 uniform mat3 normalMatrix; // model matrix
 
+// Compressed vertex attributes (see vertex_compression.hpp). 
+// Positions may be 16-bit values relative to the mesh bounding box. 
+// For uncompressed meshes positionScale is (1, 1, 1) and positionOffset is (0, 0, 0). 
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// Normals may be octahedral encoded in vNormal.xy
+uniform bool octahedralNormals;
+
+// The depth pre-pass (Rucker_depth_vertex_proj3.glsl) must produce the same depth values. 
+invariant gl_Position;
+
 out vec3 N; // the normal vector is passed over to the fragment shader
 out vec3 v; // vertex position is passed over to the fragment shader
 
 // Note that there is no out color, because the pixel color is calculated
 // in the fragment shader. 
 
+// Restore a unit normal from its octahedral encoding
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main() 
 {
-    vec4 position = vec4(vPos.xyz, 1.0);
+    vec4 position = vec4(positionOffset + vPos.xyz * positionScale, 1.0);
     gl_Position = mvpMatrix * position;
 
     vec4 eyespacePosition = mvMatrix * position;
     v = eyespacePosition.xyz;
 
-    N = normalize(normalMatrix * vNormal);
+    vec3 normal = octahedralNormals ? octahedralDecode(vNormal.xy) : vNormal;
+    N = normalize(normalMatrix * normal);
 }
 
@@ -0,0 +1,258 @@
+/* This is a utility program that loads files in stages while the window keeps drawing.
+A load goes through four stages: the file is read (IO), parsed, post-processed, and
+uploaded to the GPU. The first three run as jobs of JobSystem from job_system.hpp; the
+uploads run on the thread that owns the OpenGL context, a few milliseconds per frame.
+The following enum, classes, and function are provided.
+
+enum LoadStage {
+	LOAD_STAGE_IO, LOAD_STAGE_PARSE, LOAD_STAGE_POSTPROCESS, LOAD_STAGE_UPLOAD,
+	LOAD_STAGE_DONE, LOAD_STAGE_FAILED, LOAD_STAGE_CANCELLED
+};
+
+// Progress and cancellation of one load. The stages report their work; any thread can
+// read the progress or cancel the load.
+class LoadProgress {
+	// Reset for a new load.
+	void reset();
+
+	// Start a stage with the given amount of work (bytes, meshes, images, ...), or end the
+	// load with LOAD_STAGE_DONE or LOAD_STAGE_FAILED (LOAD_STAGE_CANCELLED if it was cancelled).
+	void beginStage(LoadStage stage, size_t workCount);
+	void finish(bool succeeded);
+
+	// Add finished work to the current stage.
+	void advance(size_t work = 1);
+
+	LoadStage stage() const;
+	float stageFraction() const; // 0 to 1 within the current stage
+	float fraction() const; // 0 to 1 over all the stages, weighted by loadStageWeights
+	bool finished() const; // DONE, FAILED, or CANCELLED
+
+	// Ask the stages to stop. They check cancelled() between pieces of work.
+	void cancel();
+	bool cancelled() const;
+
+	// Milliseconds spent in a stage. Final once the load has finished.
+	double stageMilliseconds(LoadStage stage) const;
+
+	// e.g. "parse 40% (23% total)"
+	string describe() const;
+};
+
+// Read a whole file in 1 MB pieces in the IO stage. Returns false if the file cannot be
+// read or the load is cancelled.
+bool readFileBytes(const string& filename, vector<char>& bytes, LoadProgress& progress);
+
+// GPU upload steps of the upload stage. Call run() once per frame on the OpenGL thread.
+class UploadQueue {
+	void push(function<void()> step);
+
+	// Run steps for up to budgetMilliseconds (always at least one), advancing the progress
+	// by one per step. Returns true once the queue is empty.
+	bool run(double budgetMilliseconds, LoadProgress& progress);
+
+	void clear();
+	size_t size() const;
+};
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum LoadStage {
+	LOAD_STAGE_IO,
+	LOAD_STAGE_PARSE,
+	LOAD_STAGE_POSTPROCESS,
+	LOAD_STAGE_UPLOAD,
+	LOAD_STAGE_DONE,
+	LOAD_STAGE_FAILED,
+	LOAD_STAGE_CANCELLED
+};
+
+const char* loadStageNames[] = { "IO", "parse", "post-process", "upload", "done", "failed", "cancelled" };
+
+// Share of the whole load given to each of the four working stages by LoadProgress::fraction().
+// Parsing is usually the slowest stage.
+const float loadStageWeights[4] = { 0.15f, 0.45f, 0.25f, 0.15f };
+
+// Size of the pieces that readFileBytes() reads between progress updates.
+const size_t LOAD_READ_CHUNK_SIZE = 1024 * 1024;
+
+class LoadProgress {
+public:
+	LoadProgress() { reset(); }
+
+	LoadProgress(const LoadProgress&) = delete;
+	LoadProgress& operator=(const LoadProgress&) = delete;
+
+	//------------------------------------------------
+	void reset() {
+		currentStage.store(LOAD_STAGE_IO);
+		workDone.store(0);
+		workTotal.store(0);
+		cancelRequested.store(false);
+		for (int s = 0; s < 4; s++) {
+			stageMicroseconds[s].store(0);
+		}
+		stageStart = chrono::steady_clock::now();
+	}
+
+	//------------------------------------------------
+	void beginStage(LoadStage stage, size_t workCount) {
+		endStageTimer();
+		workDone.store(0);
+		workTotal.store(workCount);
+		stageStart = chrono::steady_clock::now();
+		currentStage.store(stage, memory_order_release);
+	}
+
+	//------------------------------------------------
+	void finish(bool succeeded) {
+		endStageTimer();
+		LoadStage stage = cancelled() ? LOAD_STAGE_CANCELLED : (succeeded ? LOAD_STAGE_DONE : LOAD_STAGE_FAILED);
+		currentStage.store(stage, memory_order_release);
+	}
+
+	void advance(size_t work = 1) { workDone.fetch_add(work); }
+
+	LoadStage stage() const { return (LoadStage)currentStage.load(memory_order_acquire); }
+
+	bool finished() const { return stage() >= LOAD_STAGE_DONE; }
+
+	//------------------------------------------------
+	float stageFraction() const {
+		size_t total = workTotal.load();
+		if (total == 0) {
+			return 0.0f;
+		}
+		return min(1.0f, (float)workDone.load() / (float)total);
+	}
+
+	//------------------------------------------------
+	float fraction() const {
+		LoadStage stage = this->stage();
+		if (stage >= LOAD_STAGE_DONE) {
+			return 1.0f;
+		}
+		float sum = 0.0f;
+		for (int s = 0; s < stage; s++) {
+			sum += loadStageWeights[s];
+		}
+		return sum + loadStageWeights[stage] * stageFraction();
+	}
+
+	void cancel() { cancelRequested.store(true); }
+
+	bool cancelled() const { return cancelRequested.load(); }
+
+	//------------------------------------------------
+	double stageMilliseconds(LoadStage stage) const {
+		if (stage >= LOAD_STAGE_DONE) {
+			return 0.0;
+		}
+		return stageMicroseconds[stage].load() / 1000.0;
+	}
+
+	//------------------------------------------------
+	string describe() const {
+		LoadStage stage = this->stage();
+		ostringstream text;
+		text << loadStageNames[stage];
+		if (stage < LOAD_STAGE_DONE) {
+			text << " " << (int)(100.0f * stageFraction()) << "% (" << (int)(100.0f * fraction()) << "% total)";
+		}
+		return text.str();
+	}
+
+private:
+	// Add the time since the current stage began to that stage. Only the thread that runs
+	// the stages calls this.
+	void endStageTimer() {
+		int stage = currentStage.load();
+		if (stage < LOAD_STAGE_DONE) {
+			long long microseconds = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - stageStart).count();
+			stageMicroseconds[stage].fetch_add(microseconds);
+		}
+	}
+
+	atomic<int> currentStage;
+	atomic<size_t> workDone;
+	atomic<size_t> workTotal;
+	atomic<bool> cancelRequested;
+	atomic<long long> stageMicroseconds[4];
+	chrono::steady_clock::time_point stageStart;
+};
+
+//---------------------------------------------------------
+bool readFileBytes(const string& filename, vector<char>& bytes, LoadProgress& progress) {
+	bytes.clear();
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size < 0) {
+		fclose(file);
+		return false;
+	}
+
+	progress.beginStage(LOAD_STAGE_IO, (size_t)size);
+	bytes.resize((size_t)size);
+	size_t offset = 0;
+	while (offset < bytes.size() && !progress.cancelled()) {
+		size_t piece = min(LOAD_READ_CHUNK_SIZE, bytes.size() - offset);
+		size_t read = fread(&bytes[offset], 1, piece, file);
+		if (read == 0) {
+			break;
+		}
+		offset += read;
+		progress.advance(read);
+	}
+	fclose(file);
+
+	if (offset < bytes.size()) {
+		bytes.clear();
+		return false;
+	}
+	return true;
+}
+
+class UploadQueue {
+public:
+	void push(function<void()> step) { steps.push_back(move(step)); }
+
+	//------------------------------------------------
+	bool run(double budgetMilliseconds, LoadProgress& progress) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		do {
+			if (steps.empty()) {
+				break;
+			}
+			function<void()> step = move(steps.front());
+			steps.pop_front();
+			step();
+			progress.advance();
+		} while (chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() < budgetMilliseconds);
+		return steps.empty();
+	}
+
+	void clear() { steps.clear(); }
+
+	size_t size() const { return steps.size(); }
+
+private:
+	deque<function<void()> > steps;
+};
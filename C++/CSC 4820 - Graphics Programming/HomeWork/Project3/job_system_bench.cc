@@ -0,0 +1,294 @@
+/*
+John Rucker
+Project 3
+
+Job system scaling benchmark.
+
+Loads each 3D file with Assimp (aiProcessPreset_TargetRealtime_Quality, as in
+Rucker_proj3.cc) and runs the CPU stages that the viewers apply to the meshes on
+JobSystem from job_system.hpp, with 1 thread up to one thread per core:
+
+    bounds        bounding box of all the vertices (Project 2, get_container)
+    face copy     face indices and texture coordinates copied into flat arrays
+                  (Project 2, generateVAOandUBuffer)
+    post-process  vertex cache and fetch optimization, position quantization and
+                  octahedral normals (Project 3, prepareMeshArrays)
+
+The bounds and face copy stages split the vertex and face ranges of each mesh; the
+post-process stage runs one job per mesh, so a file with a single mesh is processed
+as if the scene held copies instances of it. For every thread count the best time of
+several runs is reported, with the speedup over one thread.
+
+Usage: job_system_bench [runs] [copies] [file ...]
+Without file names, the OBJ files bundled with Project 3 and Project 4 are measured.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "assimp/Importer.hpp"
+#include "assimp/PostProcess.h"
+#include "assimp/Scene.h"
+
+#include "job_system.hpp"
+#include "mesh_optimizer.hpp"
+#include "vertex_compression.hpp"
+
+using namespace std;
+
+const char* bundledFiles[] = {
+	"monkey_normal.obj",
+	"dog_normal.obj",
+	"bench_normal.obj",
+	"../Project4/monkey_texture.obj",
+	"../Project4/g_char.obj"
+};
+
+// Vertices or faces per job in the bounds and face copy stages.
+const size_t STAGE_GRAIN_SIZE = 16384;
+
+const int STAGE_COUNT = 3;
+const char* stageNames[STAGE_COUNT] = { "bounds", "face copy", "post-process" };
+
+// Best time of each stage for one thread count.
+struct StageTimes {
+	double milliseconds[STAGE_COUNT];
+};
+
+double elapsedMilliseconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//------------------------------------------------------
+// Bounding box of every vertex of the scene, reduced from one box per vertex range.
+void computeBounds(JobSystem& jobs, const aiScene* scene, float boundsMin[3], float boundsMax[3]) {
+	struct VertexRange {
+		const aiMesh* mesh;
+		size_t begin, end;
+		float boundsMin[3], boundsMax[3];
+	};
+	vector<VertexRange> ranges;
+	for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+		const aiMesh* mesh = scene->mMeshes[i];
+		for (size_t begin = 0; begin < mesh->mNumVertices; begin += STAGE_GRAIN_SIZE) {
+			VertexRange range = { mesh, begin, min((size_t)mesh->mNumVertices, begin + STAGE_GRAIN_SIZE) };
+			ranges.push_back(range);
+		}
+	}
+
+	jobs.parallelFor((unsigned int)ranges.size(), [&](unsigned int r) {
+		VertexRange& range = ranges[r];
+		for (int k = 0; k < 3; k++) {
+			range.boundsMin[k] = 1e10f;
+			range.boundsMax[k] = -1e10f;
+		}
+		for (size_t v = range.begin; v < range.end; v++) {
+			const float* position = &range.mesh->mVertices[v].x;
+			for (int k = 0; k < 3; k++) {
+				range.boundsMin[k] = min(range.boundsMin[k], position[k]);
+				range.boundsMax[k] = max(range.boundsMax[k], position[k]);
+			}
+		}
+	});
+
+	for (int k = 0; k < 3; k++) {
+		boundsMin[k] = 1e10f;
+		boundsMax[k] = -1e10f;
+	}
+	for (size_t r = 0; r < ranges.size(); r++) {
+		for (int k = 0; k < 3; k++) {
+			boundsMin[k] = min(boundsMin[k], ranges[r].boundsMin[k]);
+			boundsMax[k] = max(boundsMax[k], ranges[r].boundsMax[k]);
+		}
+	}
+}
+
+//------------------------------------------------------
+// Face indices and texture coordinates of every mesh in flat arrays. The meshes run in
+// parallel, and the faces of a large mesh are split again inside its job.
+void copyFaceArrays(JobSystem& jobs, const aiScene* scene, vector<vector<unsigned int> >& faceArrays,
+	vector<vector<float> >& texCoordArrays) {
+	faceArrays.resize(scene->mNumMeshes);
+	texCoordArrays.resize(scene->mNumMeshes);
+	jobs.parallelFor(scene->mNumMeshes, [&](unsigned int i) {
+		const aiMesh* mesh = scene->mMeshes[i];
+		vector<unsigned int>& faceArray = faceArrays[i];
+		faceArray.resize(3 * (size_t)mesh->mNumFaces);
+		jobs.parallelForRange(mesh->mNumFaces, STAGE_GRAIN_SIZE, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++) {
+				memcpy(&faceArray[3 * t], mesh->mFaces[t].mIndices, 3 * sizeof(unsigned int));
+			}
+		});
+
+		vector<float>& texCoords = texCoordArrays[i];
+		texCoords.clear();
+		if (mesh->HasTextureCoords(0)) {
+			texCoords.resize(2 * (size_t)mesh->mNumVertices);
+			jobs.parallelForRange(mesh->mNumVertices, STAGE_GRAIN_SIZE, [&](size_t begin, size_t end) {
+				for (size_t k = begin; k < end; k++) {
+					texCoords[2 * k] = mesh->mTextureCoords[0][k].x;
+					texCoords[2 * k + 1] = mesh->mTextureCoords[0][k].y;
+				}
+			});
+		}
+	});
+}
+
+//------------------------------------------------------
+// Optimize and compress one mesh from its face array.
+void postProcessMesh(const aiMesh* mesh, vector<unsigned int> faceArray) {
+	unsigned int vertexCount = mesh->mNumVertices;
+	vector<unsigned int> remap(vertexCount);
+	for (unsigned int j = 0; j < vertexCount; j++) {
+		remap[j] = j;
+	}
+	if (!faceArray.empty()) {
+		optimizeVertexCache(&faceArray[0], (unsigned int)faceArray.size(), vertexCount);
+		vertexCount = optimizeVertexFetch(&faceArray[0], (unsigned int)faceArray.size(), mesh->mNumVertices, remap);
+	}
+	if (vertexCount == 0) {
+		return;
+	}
+
+	vector<aiVector3D> positions(vertexCount);
+	remapVertexStream(&positions[0], mesh->mVertices, sizeof(aiVector3D), mesh->mNumVertices, remap);
+	vector<unsigned short> quantized(4 * vertexCount);
+	float positionScale[3], positionOffset[3];
+	quantizePositions(&positions[0].x, vertexCount, &quantized[0], positionScale, positionOffset);
+
+	if (mesh->HasNormals()) {
+		vector<aiVector3D> normals(vertexCount);
+		remapVertexStream(&normals[0], mesh->mNormals, sizeof(aiVector3D), mesh->mNumVertices, remap);
+		vector<short> encoded(2 * vertexCount);
+		for (unsigned int j = 0; j < vertexCount; j++) {
+			octahedralEncode(&normals[j].x, &encoded[2 * j]);
+		}
+	}
+}
+
+//------------------------------------------------------
+// Run the stages with the given number of threads (the calling thread and threadCount - 1
+// workers) and keep the best time of each stage.
+StageTimes measureStages(const aiScene* scene, unsigned int threadCount, int runs, unsigned int copies) {
+	JobSystem jobs;
+	if (threadCount > 1) {
+		jobs.start(threadCount - 1);
+	}
+
+	StageTimes best;
+	for (int s = 0; s < STAGE_COUNT; s++) {
+		best.milliseconds[s] = 0.0;
+	}
+
+	for (int run = 0; run < runs; run++) {
+		double milliseconds[STAGE_COUNT];
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		float boundsMin[3], boundsMax[3];
+		computeBounds(jobs, scene, boundsMin, boundsMax);
+		milliseconds[0] = elapsedMilliseconds(start);
+
+		start = chrono::steady_clock::now();
+		vector<vector<unsigned int> > faceArrays;
+		vector<vector<float> > texCoordArrays;
+		copyFaceArrays(jobs, scene, faceArrays, texCoordArrays);
+		milliseconds[1] = elapsedMilliseconds(start);
+
+		start = chrono::steady_clock::now();
+		jobs.parallelFor(copies * scene->mNumMeshes, [&](unsigned int job) {
+			unsigned int i = job % scene->mNumMeshes;
+			postProcessMesh(scene->mMeshes[i], faceArrays[i]);
+		});
+		milliseconds[2] = elapsedMilliseconds(start);
+
+		for (int s = 0; s < STAGE_COUNT; s++) {
+			if (run == 0 || milliseconds[s] < best.milliseconds[s]) {
+				best.milliseconds[s] = milliseconds[s];
+			}
+		}
+	}
+	return best;
+}
+
+//------------------------------------------------------------
+// Measure one file with every thread count. Returns false on load error.
+bool measureFile(const char* filename, int runs, unsigned int copies, unsigned int coreCount) {
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(filename, aiProcessPreset_TargetRealtime_Quality);
+	if (!scene) {
+		cout << filename << ": " << importer.GetErrorString() << endl << endl;
+		return false;
+	}
+
+	size_t vertices = 0, triangles = 0;
+	for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+		vertices += scene->mMeshes[i]->mNumVertices;
+		triangles += scene->mMeshes[i]->mNumFaces;
+	}
+	cout << filename << ": " << scene->mNumMeshes << " meshes, " << vertices << " vertices, "
+		<< triangles << " triangles" << endl;
+
+	cout << "    " << setw(8) << "threads";
+	for (int s = 0; s < STAGE_COUNT; s++) {
+		cout << setw(14) << stageNames[s] << setw(9) << "speedup";
+	}
+	cout << endl;
+
+	StageTimes serial;
+	for (unsigned int threadCount = 1; threadCount <= coreCount; threadCount++) {
+		StageTimes times = measureStages(scene, threadCount, runs, copies);
+		if (threadCount == 1) {
+			serial = times;
+		}
+		cout << "    " << setw(8) << threadCount << fixed;
+		for (int s = 0; s < STAGE_COUNT; s++) {
+			double speedup = times.milliseconds[s] > 0.0 ? serial.milliseconds[s] / times.milliseconds[s] : 0.0;
+			cout << setprecision(3) << setw(11) << times.milliseconds[s] << " ms"
+				<< setprecision(2) << setw(8) << speedup << "x";
+		}
+		cout << endl;
+	}
+	cout << endl;
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	int runs = 5;
+	unsigned int copies = 8;
+	int firstFile = 1;
+
+	// Optional leading numbers select the number of runs and of mesh copies.
+	if (argc > firstFile && atoi(argv[firstFile]) > 0) {
+		runs = atoi(argv[firstFile]);
+		firstFile++;
+	}
+	if (argc > firstFile && atoi(argv[firstFile]) > 0) {
+		copies = (unsigned int)atoi(argv[firstFile]);
+		firstFile++;
+	}
+
+	unsigned int coreCount = thread::hardware_concurrency();
+	if (coreCount == 0) {
+		coreCount = 1;
+	}
+
+	cout << "Best of " << runs << " runs, " << copies << " copies of each mesh in post-process, "
+		<< coreCount << " cores" << endl << endl;
+
+	bool allLoaded = true;
+
+	if (firstFile >= argc) {
+		for (unsigned int i = 0; i < sizeof(bundledFiles) / sizeof(bundledFiles[0]); i++) {
+			allLoaded = measureFile(bundledFiles[i], runs, copies, coreCount) && allLoaded;
+		}
+	} else {
+		for (int i = firstFile; i < argc; i++) {
+			allLoaded = measureFile(argv[i], runs, copies, coreCount) && allLoaded;
+		}
+	}
+
+	return allLoaded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+/*
+John Rucker
+Project 3
+
+Clustered lighting benchmark.
+
+Scatters point lights in front of the camera and sorts them into the clusters of the
+view frustum with LightClusterGrid from light_clusters.hpp, for light counts from 16 to
+16384. For each count it reports the best time of several runs, the number of light list
+entries, and the average and largest number of lights a pixel loops over. Without
+clusters, every pixel would loop over all the lights.
+
+Every assignment is also checked at random points in the frustum: a light that reaches
+a point but is missing from the list of the point's cluster is reported.
+
+The GPU side is measured in Rucker_proj3.cc: press 'b' to render the scene with a
+range of light counts and print the frame times.
+
+Usage: light_cluster_bench [runs]
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "light_clusters.hpp"
+
+using namespace std;
+
+const unsigned int lightCounts[] = { 16, 64, 256, 1024, 4096, 16384 };
+
+double elapsedMilliseconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+float randomUnit() {
+	return (float)rand() / RAND_MAX;
+}
+
+//------------------------------------------------------
+// Lights in eye space, between 1 and 20 units in front of the camera.
+vector<PointLight> createLights(unsigned int count) {
+	vector<PointLight> lights(count);
+	srand(12345);
+	for (unsigned int i = 0; i < count; i++) {
+		float depth = 1.0f + 19.0f * randomUnit();
+		lights[i].position[0] = (randomUnit() * 2.0f - 1.0f) * depth;
+		lights[i].position[1] = (randomUnit() * 2.0f - 1.0f) * depth * 0.6f;
+		lights[i].position[2] = -depth;
+		lights[i].position[3] = 0.5f + randomUnit();
+		for (int c = 0; c < 3; c++) {
+			lights[i].color[c] = randomUnit();
+		}
+		lights[i].color[3] = 1.0f;
+	}
+	return lights;
+}
+
+//------------------------------------------------------
+// Pick random points in the view frustum, find their clusters the way the fragment shader
+// does, and count the lights that reach a point but are not in the list of its cluster.
+unsigned int countMissingLights(const LightClusterGrid& grid, const vector<PointLight>& lights,
+	float fovyDegrees, float aspect) {
+	const vector<unsigned int>& ranges = grid.clusterRanges();
+	const vector<unsigned int>& indices = grid.lightIndices();
+	float tanHalfFovy = tan(fovyDegrees * 3.14159265f / 360.0f);
+	float sliceScale, sliceBias;
+	grid.sliceParameters(sliceScale, sliceBias);
+
+	unsigned int missing = 0;
+	for (int sample = 0; sample < 20000; sample++) {
+		float ndcX = randomUnit() * 2.0f - 1.0f;
+		float ndcY = randomUnit() * 2.0f - 1.0f;
+		float depth = 0.5f + 21.0f * randomUnit(); // where the lights are
+		float point[3] = { ndcX * depth * tanHalfFovy * aspect, ndcY * depth * tanHalfFovy, -depth };
+
+		int x = min(CLUSTER_X - 1, (int)((ndcX + 1.0f) * 0.5f * CLUSTER_X));
+		int y = min(CLUSTER_Y - 1, (int)((ndcY + 1.0f) * 0.5f * CLUSTER_Y));
+		int z = max(0, min(CLUSTER_Z - 1, (int)(log(depth) * sliceScale + sliceBias)));
+		int cluster = LightClusterGrid::clusterIndex(x, y, z);
+
+		for (unsigned int light = 0; light < lights.size(); light++) {
+			float distanceSquared = 0.0f;
+			for (int axis = 0; axis < 3; axis++) {
+				float d = point[axis] - lights[light].position[axis];
+				distanceSquared += d * d;
+			}
+			if (distanceSquared > lights[light].position[3] * lights[light].position[3]) {
+				continue;
+			}
+
+			bool listed = false;
+			for (unsigned int i = 0; i < ranges[2 * cluster + 1] && !listed; i++) {
+				listed = indices[ranges[2 * cluster] + i] == light;
+			}
+			missing += listed ? 0 : 1;
+		}
+	}
+	return missing;
+}
+
+//------------------------------------------------------
+int main(int argc, char* argv[]) {
+	int runs = argc > 1 ? atoi(argv[1]) : 10;
+	if (runs < 1) {
+		runs = 1;
+	}
+
+	// The projection of Rucker_proj3.cc with a 16:9 window.
+	const float fovy = 60.0f, aspect = 16.0f / 9.0f, nearPlane = 0.1f, farPlane = 1000.0f;
+	LightClusterGrid grid;
+	grid.setProjection(fovy, aspect, nearPlane, farPlane);
+
+	cout << CLUSTER_X << " x " << CLUSTER_Y << " x " << CLUSTER_Z << " clusters, best of " << runs << " runs" << endl << endl;
+	cout << setw(8) << "lights" << setw(12) << "ms" << setw(10) << "entries"
+		<< setw(14) << "avg/cluster" << setw(14) << "max/cluster" << setw(10) << "missing" << endl;
+
+	for (unsigned int c = 0; c < sizeof(lightCounts) / sizeof(lightCounts[0]); c++) {
+		vector<PointLight> lights = createLights(lightCounts[c]);
+
+		double best = 1e30;
+		for (int run = 0; run < runs; run++) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			grid.assignLights(lights);
+			best = min(best, elapsedMilliseconds(start));
+		}
+
+		// Average over the clusters that have any light, since only those are lit.
+		const vector<unsigned int>& ranges = grid.clusterRanges();
+		unsigned int litClusters = 0;
+		for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+			litClusters += ranges[2 * cluster + 1] > 0 ? 1 : 0;
+		}
+		double average = litClusters > 0 ? (double)grid.lightIndices().size() / litClusters : 0.0;
+
+		cout << setw(8) << lightCounts[c] << setw(12) << fixed << setprecision(3) << best
+			<< setw(10) << grid.lightIndices().size() << setw(14) << setprecision(1) << average
+			<< setw(14) << grid.maxLightsPerCluster() << setw(10) << countMissingLights(grid, lights, fovy, aspect) << endl;
+	}
+
+	return 0;
+}
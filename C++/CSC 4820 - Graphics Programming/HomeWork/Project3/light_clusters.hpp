@@ -0,0 +1,243 @@
+/* This is a utility program for clustered forward shading: it sorts point lights into the
+clusters (froxels) of the view frustum, so that the fragment shader only loops over the
+lights that can reach the cluster of its pixel.
+The following struct and class are provided.
+
+// A point light. It has no effect beyond its radius.
+struct PointLight {
+	float position[4]; // xyz: eye space position, w: radius
+	float color[4]; // rgb: intensity
+};
+
+class LightClusterGrid {
+	// Build the cluster bounding boxes for a symmetric perspective projection.
+	// Call again when the projection changes (e.g. in the reshape callback).
+	void setProjection(float fovyDegrees, float aspect, float nearPlane, float farPlane);
+
+	// Sort the lights (in eye space) into the clusters.
+	void assignLights(const vector<PointLight>& lights);
+
+	// Two values per cluster: the offset of its first entry in lightIndices() and its light count.
+	const vector<unsigned int>& clusterRanges();
+
+	// The light indices of all the clusters, one list after another.
+	const vector<unsigned int>& lightIndices();
+
+	// Values for the uniforms of the fragment shader (see Rucker_frag_proj3.glsl).
+	void sliceParameters(float& scale, float& bias);
+};
+
+The frustum is divided into CLUSTER_X x CLUSTER_Y screen tiles and CLUSTER_Z depth slices.
+The slices are spaced exponentially between the near and the far plane, so a cluster is
+about as deep as it is wide. The fragment shader finds its slice with
+	slice = log(depth) * scale + bias
+
+Cluster (x, y, z) has the index x + CLUSTER_X * (y + CLUSTER_Y * z); x = 0 is the left and
+y = 0 the bottom of the screen, as for gl_FragCoord.
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+struct PointLight {
+	float position[4]; // xyz: eye space position, w: radius
+	float color[4]; // rgb: intensity
+};
+
+class LightClusterGrid {
+public:
+	LightClusterGrid() : tanHalfFovy(0.0f), aspectRatio(1.0f), nearDepth(0.1f), farDepth(1000.0f) {}
+
+	//------------------------------------------------
+	void setProjection(float fovyDegrees, float aspect, float nearPlane, float farPlane) {
+		tanHalfFovy = tan(fovyDegrees * 3.14159265f / 360.0f);
+		aspectRatio = aspect;
+		nearDepth = nearPlane;
+		farDepth = farPlane;
+
+		for (int z = 0; z <= CLUSTER_Z; z++) {
+			sliceDepths[z] = sliceDepth(z);
+		}
+
+		// Each cluster is a frustum piece between two slice depths. Its bounding box is the box
+		// around its 8 corners. Eye space looks down -z, so the depths are negated.
+		for (int z = 0; z < CLUSTER_Z; z++) {
+			for (int y = 0; y < CLUSTER_Y; y++) {
+				for (int x = 0; x < CLUSTER_X; x++) {
+					ClusterBounds& bounds = clusterBounds[clusterIndex(x, y, z)];
+					for (int axis = 0; axis < 3; axis++) {
+						bounds.minimum[axis] = 1e30f;
+						bounds.maximum[axis] = -1e30f;
+					}
+					for (int corner = 0; corner < 8; corner++) {
+						float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / CLUSTER_X;
+						float ndcY = -1.0f + 2.0f * (y + ((corner >> 1) & 1)) / CLUSTER_Y;
+						float depth = sliceDepths[z + ((corner >> 2) & 1)];
+						float point[3] = {
+							ndcX * depth * tanHalfFovy * aspectRatio,
+							ndcY * depth * tanHalfFovy,
+							-depth
+						};
+						for (int axis = 0; axis < 3; axis++) {
+							bounds.minimum[axis] = min(bounds.minimum[axis], point[axis]);
+							bounds.maximum[axis] = max(bounds.maximum[axis], point[axis]);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	//------------------------------------------------
+	void assignLights(const vector<PointLight>& lights) {
+		// First collect (cluster, light) pairs, then sort them into one list per cluster
+		// with a counting sort, so that each list is contiguous.
+		pairs.clear();
+		for (unsigned int i = 0; i < lights.size(); i++) {
+			addLight(lights[i], i);
+		}
+
+		ranges.assign(2 * CLUSTER_COUNT, 0);
+		for (unsigned int i = 0; i < pairs.size(); i++) {
+			ranges[2 * pairs[i].cluster + 1]++;
+		}
+
+		unsigned int offset = 0;
+		for (int c = 0; c < CLUSTER_COUNT; c++) {
+			ranges[2 * c] = offset;
+			offset += ranges[2 * c + 1];
+		}
+
+		indices.resize(pairs.size());
+		vector<unsigned int> fill(CLUSTER_COUNT, 0);
+		for (unsigned int i = 0; i < pairs.size(); i++) {
+			unsigned int c = pairs[i].cluster;
+			indices[ranges[2 * c] + fill[c]++] = pairs[i].light;
+		}
+	}
+
+	const vector<unsigned int>& clusterRanges() const { return ranges; }
+	const vector<unsigned int>& lightIndices() const { return indices; }
+
+	//------------------------------------------------
+	void sliceParameters(float& scale, float& bias) const {
+		float logRatio = log(farDepth / nearDepth);
+		scale = CLUSTER_Z / logRatio;
+		bias = -CLUSTER_Z * log(nearDepth) / logRatio;
+	}
+
+	// The largest number of lights in one cluster after assignLights().
+	unsigned int maxLightsPerCluster() const {
+		unsigned int largest = 0;
+		for (int c = 0; c < CLUSTER_COUNT && !ranges.empty(); c++) {
+			largest = max(largest, ranges[2 * c + 1]);
+		}
+		return largest;
+	}
+
+	static int clusterIndex(int x, int y, int z) {
+		return x + CLUSTER_X * (y + CLUSTER_Y * z);
+	}
+
+	// True if the light's sphere touches the bounding box of the cluster.
+	bool lightTouchesCluster(const PointLight& light, int cluster) const {
+		const ClusterBounds& bounds = clusterBounds[cluster];
+		float distanceSquared = 0.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			float p = light.position[axis];
+			float d = p < bounds.minimum[axis] ? bounds.minimum[axis] - p :
+				(p > bounds.maximum[axis] ? p - bounds.maximum[axis] : 0.0f);
+			distanceSquared += d * d;
+		}
+		return distanceSquared <= light.position[3] * light.position[3];
+	}
+
+private:
+	struct ClusterBounds {
+		float minimum[3];
+		float maximum[3];
+	};
+
+	struct ClusterLight {
+		unsigned int cluster;
+		unsigned int light;
+	};
+
+	float sliceDepth(int slice) const {
+		return nearDepth * pow(farDepth / nearDepth, (float)slice / CLUSTER_Z);
+	}
+
+	//------------------------------------------------
+	// Find the clusters the light reaches. Only the clusters inside the screen space box
+	// around the sphere are tested against the sphere.
+	void addLight(const PointLight& light, unsigned int lightIndex) {
+		float x = light.position[0], y = light.position[1];
+		float depth = -light.position[2];
+		float radius = light.position[3];
+
+		float nearest = depth - radius, farthest = depth + radius;
+		if (farthest <= nearDepth || nearest >= farDepth) {
+			return;
+		}
+		nearest = max(nearest, nearDepth);
+		farthest = min(farthest, farDepth);
+
+		int firstSlice = (int)(upper_bound(sliceDepths, sliceDepths + CLUSTER_Z + 1, nearest) - sliceDepths) - 1;
+		int lastSlice = (int)(upper_bound(sliceDepths, sliceDepths + CLUSTER_Z + 1, farthest) - sliceDepths) - 1;
+		firstSlice = max(firstSlice, 0);
+		lastSlice = min(lastSlice, CLUSTER_Z - 1);
+
+		// The box around the sphere projects to a screen rectangle whose corners come from the
+		// corners of the box, since x / depth is monotonic in x and in depth for depth > 0.
+		float xScale = 1.0f / (tanHalfFovy * aspectRatio), yScale = 1.0f / tanHalfFovy;
+		float ndcMinX = 1e30f, ndcMaxX = -1e30f, ndcMinY = 1e30f, ndcMaxY = -1e30f;
+		float depths[2] = { nearest, farthest };
+		for (int d = 0; d < 2; d++) {
+			for (int s = -1; s <= 1; s += 2) {
+				float ndcX = (x + s * radius) * xScale / depths[d];
+				float ndcY = (y + s * radius) * yScale / depths[d];
+				ndcMinX = min(ndcMinX, ndcX);
+				ndcMaxX = max(ndcMaxX, ndcX);
+				ndcMinY = min(ndcMinY, ndcY);
+				ndcMaxY = max(ndcMaxY, ndcY);
+			}
+		}
+
+		int firstX = max(0, (int)floor((ndcMinX + 1.0f) * 0.5f * CLUSTER_X));
+		int lastX = min(CLUSTER_X - 1, (int)floor((ndcMaxX + 1.0f) * 0.5f * CLUSTER_X));
+		int firstY = max(0, (int)floor((ndcMinY + 1.0f) * 0.5f * CLUSTER_Y));
+		int lastY = min(CLUSTER_Y - 1, (int)floor((ndcMaxY + 1.0f) * 0.5f * CLUSTER_Y));
+
+		for (int z = firstSlice; z <= lastSlice; z++) {
+			for (int cy = firstY; cy <= lastY; cy++) {
+				for (int cx = firstX; cx <= lastX; cx++) {
+					int cluster = clusterIndex(cx, cy, z);
+					if (lightTouchesCluster(light, cluster)) {
+						ClusterLight pair = { (unsigned int)cluster, lightIndex };
+						pairs.push_back(pair);
+					}
+				}
+			}
+		}
+	}
+
+	float tanHalfFovy;
+	float aspectRatio;
+	float nearDepth;
+	float farDepth;
+	float sliceDepths[CLUSTER_Z + 1];
+	ClusterBounds clusterBounds[CLUSTER_COUNT];
+
+	vector<ClusterLight> pairs;
+	vector<unsigned int> ranges; // offset and count of each cluster
+	vector<unsigned int> indices;
+};
@@ -0,0 +1,131 @@
+/*
+John Rucker
+Project 3
+
+Vertex cache metrics tool.
+
+Loads each 3D file with the same Assimp flags as Rucker_proj3.cc and reports the
+ACMR (transformed vertices per triangle) and ATVR (transformed vertices per unique vertex)
+of the index buffer before and after optimizeVertexCache()/optimizeVertexFetch().
+Lower is better. The ideal ATVR is 1.0, where every vertex is shaded exactly once.
+
+Usage: mesh_cache_metrics [cache size] [file.obj ...]
+Without file names, the OBJ files bundled with Project 3 are measured.
+*/
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "assimp/Importer.hpp"
+#include "assimp/PostProcess.h"
+#include "assimp/Scene.h"
+
+#include "mesh_optimizer.hpp"
+
+using namespace std;
+
+const char* bundledFiles[] = {
+	"simple_box.obj",
+	"monkey_normal.obj",
+	"dog_normal.obj",
+	"bench_normal.obj"
+};
+
+//-----------------------------------------------
+// Print one line of the report for a single mesh
+void printStats(const char* label, const VertexCacheStats& stats) {
+	cout << "    " << setw(10) << left << label << right
+		<< " triangles " << setw(6) << stats.triangles
+		<< "  vertices " << setw(6) << stats.uniqueVertices
+		<< "  VS invocations " << setw(6) << stats.transformedVertices
+		<< "  ACMR " << fixed << setprecision(3) << stats.acmr
+		<< "  ATVR " << stats.atvr << endl;
+}
+
+//------------------------------------------------------------
+// Measure every mesh of a 3D file. Returns false on load error.
+bool measureFile(const char* filename, unsigned int cacheSize) {
+	Assimp::Importer importer;
+
+	const aiScene* scene = importer.ReadFile(filename, aiProcessPreset_TargetRealtime_Quality);
+	if (!scene) {
+		cout << filename << ": " << importer.GetErrorString() << endl;
+		return false;
+	}
+
+	cout << filename << endl;
+
+	unsigned int totalBefore = 0, totalAfter = 0;
+
+	for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+		const aiMesh* currentMesh = scene->mMeshes[i];
+		if (!currentMesh->HasFaces()) {
+			continue;
+		}
+
+		// Copy the face indices into a continuous 1D array, exactly like init() does.
+		vector<unsigned int> faceArray;
+		faceArray.reserve(currentMesh->mNumFaces * 3);
+		for (unsigned int j = 0; j < currentMesh->mNumFaces; j++) {
+			for (unsigned int k = 0; k < currentMesh->mFaces[j].mNumIndices; k++) {
+				faceArray.push_back(currentMesh->mFaces[j].mIndices[k]);
+			}
+		}
+
+		unsigned int numIndices = (unsigned int)faceArray.size();
+		unsigned int numVertices = currentMesh->mNumVertices;
+
+		VertexCacheStats before = analyzeVertexCache(&faceArray[0], numIndices, numVertices, cacheSize);
+
+		vector<unsigned int> vertexRemap;
+		optimizeVertexCache(&faceArray[0], numIndices, numVertices);
+		numVertices = optimizeVertexFetch(&faceArray[0], numIndices, numVertices, vertexRemap);
+
+		VertexCacheStats after = analyzeVertexCache(&faceArray[0], numIndices, numVertices, cacheSize);
+
+		cout << "  Mesh #" << i << " " << currentMesh->mName.C_Str() << endl;
+		printStats("before", before);
+		printStats("after", after);
+
+		totalBefore += before.transformedVertices;
+		totalAfter += after.transformedVertices;
+	}
+
+	if (totalBefore > 0) {
+		cout << "  Vertex shader invocations per draw: " << totalBefore << " -> " << totalAfter
+			<< " (" << fixed << setprecision(1)
+			<< 100.0f * (1.0f - (float)totalAfter / totalBefore) << "% fewer)" << endl;
+	}
+	cout << endl;
+
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	unsigned int cacheSize = DEFAULT_FIFO_CACHE_SIZE;
+	int firstFile = 1;
+
+	// An optional leading number selects the simulated FIFO cache size.
+	if (argc > 1 && atoi(argv[1]) > 0) {
+		cacheSize = atoi(argv[1]);
+		firstFile = 2;
+	}
+
+	cout << "Simulated FIFO vertex cache size: " << cacheSize << endl << endl;
+
+	bool allLoaded = true;
+
+	if (firstFile >= argc) {
+		for (unsigned int i = 0; i < sizeof(bundledFiles) / sizeof(bundledFiles[0]); i++) {
+			allLoaded = measureFile(bundledFiles[i], cacheSize) && allLoaded;
+		}
+	} else {
+		for (int i = firstFile; i < argc; i++) {
+			allLoaded = measureFile(argv[i], cacheSize) && allLoaded;
+		}
+	}
+
+	return allLoaded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,300 @@
+/* This is a utility program that reorders the index and vertex buffers of a triangle mesh
+so that the GPU runs the vertex shader as few times as possible.
+The following functions are provided.
+
+// Reorder the triangles of an indexed triangle list so that vertices are reused while they
+// are still in the post-transform vertex cache (Tom Forsyth's linear-speed algorithm).
+void optimizeVertexCache(unsigned int *indices, unsigned int indexCount, unsigned int vertexCount);
+
+// Renumber the vertices in the order they are first referenced by the index buffer,
+// so that vertex fetch reads memory sequentially. Returns the number of vertices kept.
+unsigned int optimizeVertexFetch(unsigned int *indices, unsigned int indexCount,
+	unsigned int vertexCount, vector<unsigned int> &remap);
+
+// Copy a vertex attribute array into a new array according to the remap table.
+void remapVertexStream(void *destination, const void *source, size_t vertexSize,
+	unsigned int vertexCount, const vector<unsigned int> &remap);
+
+// Simulate a FIFO post-transform cache and compute ACMR (average cache miss ratio,
+// transformed vertices per triangle) and ATVR (average transformed vertex ratio,
+// transformed vertices per unique vertex).
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, unsigned int indexCount,
+	unsigned int vertexCount, unsigned int cacheSize);
+
+Only triangle lists are supported, which is what Assimp produces with
+aiProcessPreset_TargetRealtime_Quality.
+
+*/
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// Size of the LRU cache modelled by the Forsyth scoring function.
+// This is deliberately larger than any real FIFO cache; it only steers the triangle order.
+const int FORSYTH_CACHE_SIZE = 32;
+
+// Vertex shader invocations reported by analyzeVertexCache() are simulated with this FIFO size.
+const unsigned int DEFAULT_FIFO_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+	unsigned int triangles;
+	unsigned int uniqueVertices;
+	unsigned int transformedVertices; // cache misses, i.e. vertex shader invocations
+	float acmr;
+	float atvr;
+};
+
+//------------------------------------------------------------------------
+// Score of a vertex based on its position in the LRU cache and the number
+// of triangles that still need it. Higher scores are emitted first.
+float forsythVertexScore(int cachePosition, unsigned int remainingValence) {
+	if (remainingValence == 0) {
+		return -1.0f; // No triangle needs this vertex any more.
+	}
+
+	float score = 0.0f;
+
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			// The vertices of the last triangle are used again with a fixed score,
+			// so that strips are not favoured over fans.
+			score = 0.75f;
+		} else {
+			float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = 1.0f - (cachePosition - 3) * scaler;
+			score = pow(score, 1.5f);
+		}
+	}
+
+	// Bonus for vertices with few remaining triangles, so that lone triangles
+	// are not left behind to be drawn with a cold cache at the end.
+	score += 2.0f * pow((float)remainingValence, -0.5f);
+
+	return score;
+}
+
+//------------------------------------------------------------------------
+// Reorder the triangles in place. indexCount must be a multiple of 3.
+void optimizeVertexCache(unsigned int *indices, unsigned int indexCount, unsigned int vertexCount) {
+	unsigned int triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// Build the vertex-to-triangle adjacency in a single flat array.
+	vector<unsigned int> valence(vertexCount, 0);
+	for (unsigned int i = 0; i < indexCount; i++) {
+		valence[indices[i]]++;
+	}
+
+	vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+	}
+
+	vector<unsigned int> adjacency(indexCount);
+	vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; t++) {
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int v = indices[t * 3 + k];
+			adjacency[fill[v]++] = t;
+		}
+	}
+
+	// valence[] now becomes the number of triangles that still need each vertex.
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		vertexScore[v] = forsythVertexScore(-1, valence[v]);
+	}
+
+	vector<float> triangleScore(triangleCount);
+	for (unsigned int t = 0; t < triangleCount; t++) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]]
+			+ vertexScore[indices[t * 3 + 2]];
+	}
+
+	vector<bool> emitted(triangleCount, false);
+	vector<unsigned int> output;
+	output.reserve(indexCount);
+
+	// The LRU cache has room for 3 extra entries so that a new triangle can be pushed
+	// before the oldest vertices fall out.
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+
+	unsigned int deadEndCursor = 0;
+	int bestTriangle = -1;
+
+	for (unsigned int emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		if (bestTriangle < 0) {
+			// Dead end: none of the cached vertices has a pending triangle.
+			// Continue with the first triangle in input order that has not been emitted.
+			// The cursor only moves forward, so all the dead ends together take linear time.
+			while (emitted[deadEndCursor]) {
+				deadEndCursor++;
+			}
+			bestTriangle = deadEndCursor;
+		}
+
+		unsigned int *triangle = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+
+		// Emit the triangle and push its vertices to the front of the LRU cache.
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int newCacheCount = 0;
+
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int v = triangle[k];
+			output.push_back(v);
+
+			// Degenerate triangles may reference the same vertex twice.
+			if ((k < 1 || v != triangle[0]) && (k < 2 || v != triangle[1])) {
+				newCache[newCacheCount++] = v;
+			}
+
+			// Remove the emitted triangle from the adjacency list of this vertex.
+			unsigned int *begin = &adjacency[adjacencyOffset[v]];
+			unsigned int *end = begin + valence[v];
+			for (unsigned int *it = begin; it != end; it++) {
+				if (*it == (unsigned int)bestTriangle) {
+					*it = *(end - 1);
+					break;
+				}
+			}
+			valence[v]--;
+		}
+
+		for (unsigned int c = 0; c < cacheCount; c++) {
+			unsigned int v = cache[c];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// Vertices pushed past the end of the LRU lose their cache score, and so do the
+		// triangles that still need them.
+		for (unsigned int c = FORSYTH_CACHE_SIZE; c < newCacheCount; c++) {
+			unsigned int v = newCache[c];
+			cachePosition[v] = -1;
+
+			float oldScore = vertexScore[v];
+			float newScore = forsythVertexScore(-1, valence[v]);
+			vertexScore[v] = newScore;
+
+			unsigned int *begin = &adjacency[adjacencyOffset[v]];
+			unsigned int *end = begin + valence[v];
+			for (unsigned int *it = begin; it != end; it++) {
+				triangleScore[*it] += newScore - oldScore;
+			}
+		}
+
+		cacheCount = newCacheCount < FORSYTH_CACHE_SIZE ? newCacheCount : FORSYTH_CACHE_SIZE;
+		memcpy(cache, newCache, sizeof(unsigned int) * cacheCount);
+
+		// Update the scores of the cached vertices and their pending triangles,
+		// and find the best candidate for the next iteration.
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+
+		for (unsigned int c = 0; c < cacheCount; c++) {
+			unsigned int v = cache[c];
+			cachePosition[v] = c;
+
+			float oldScore = vertexScore[v];
+			float newScore = forsythVertexScore(c, valence[v]);
+			vertexScore[v] = newScore;
+
+			unsigned int *begin = &adjacency[adjacencyOffset[v]];
+			unsigned int *end = begin + valence[v];
+			for (unsigned int *it = begin; it != end; it++) {
+				unsigned int t = *it;
+				triangleScore[t] += newScore - oldScore;
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	memcpy(indices, &output[0], sizeof(unsigned int) * indexCount);
+}
+
+//------------------------------------------------------------------------
+// Renumber the vertices in first-use order. remap[oldIndex] is the new index,
+// or 0xffffffff if the vertex is not referenced by any triangle.
+unsigned int optimizeVertexFetch(unsigned int *indices, unsigned int indexCount,
+	unsigned int vertexCount, vector<unsigned int> &remap) {
+
+	remap.assign(vertexCount, 0xffffffffu);
+	unsigned int nextVertex = 0;
+
+	for (unsigned int i = 0; i < indexCount; i++) {
+		unsigned int v = indices[i];
+		if (remap[v] == 0xffffffffu) {
+			remap[v] = nextVertex++;
+		}
+		indices[i] = remap[v];
+	}
+
+	return nextVertex;
+}
+
+//------------------------------------------------------------------------
+// Scatter a vertex attribute array (positions, normals, ...) into its new order.
+// destination must hold as many vertices as optimizeVertexFetch() returned.
+void remapVertexStream(void *destination, const void *source, size_t vertexSize,
+	unsigned int vertexCount, const vector<unsigned int> &remap) {
+
+	const char *src = (const char *)source;
+	char *dst = (char *)destination;
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		if (remap[v] != 0xffffffffu) {
+			memcpy(dst + remap[v] * vertexSize, src + v * vertexSize, vertexSize);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+// Count vertex shader invocations with a FIFO cache, which is how most GPUs
+// reuse post-transform vertices.
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, unsigned int indexCount,
+	unsigned int vertexCount, unsigned int cacheSize = DEFAULT_FIFO_CACHE_SIZE) {
+
+	VertexCacheStats stats = {0, 0, 0, 0.0f, 0.0f};
+	stats.triangles = indexCount / 3;
+
+	// timestamp[v] records when vertex v entered the cache. A vertex is still
+	// cached if fewer than cacheSize misses happened since then.
+	vector<unsigned int> timestamp(vertexCount, 0);
+	vector<bool> referenced(vertexCount, false);
+	unsigned int clock = cacheSize + 1;
+
+	for (unsigned int i = 0; i < indexCount; i++) {
+		unsigned int v = indices[i];
+
+		if (!referenced[v]) {
+			referenced[v] = true;
+			stats.uniqueVertices++;
+		}
+
+		if (clock - timestamp[v] > cacheSize) {
+			timestamp[v] = clock++;
+			stats.transformedVertices++;
+		}
+	}
+
+	if (stats.triangles > 0) {
+		stats.acmr = (float)stats.transformedVertices / stats.triangles;
+	}
+	if (stats.uniqueVertices > 0) {
+		stats.atvr = (float)stats.transformedVertices / stats.uniqueVertices;
+	}
+
+	return stats;
+}
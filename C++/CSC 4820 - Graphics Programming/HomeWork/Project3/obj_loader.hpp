@@ -0,0 +1,694 @@
+/* This is a utility program that reads Wavefront OBJ/MTL files without Assimp.
+The following functions are provided.
+
+// Read an OBJ file (and the MTL files it references) into an ObjModel.
+// The file is memory mapped and split into line ranges that are parsed on threadCount
+// threads (0 means one thread per CPU core). Returns false if the file cannot be read.
+bool loadObjFile(const char *filename, ObjModel &model, unsigned int threadCount);
+
+// Parse OBJ text that is already in memory, e.g. read by the IO stage of async_loader.hpp.
+// MTL files are looked up in directory (which ends with a slash, or is empty).
+bool parseObjData(const char *data, size_t size, const string &directory, ObjModel &model,
+	unsigned int threadCount);
+
+// Read the materials of an MTL file and append them to the materials array.
+bool loadMtlFile(const char *filename, vector<ObjMaterial> &materials);
+
+The model is output in an interleaved layout: one ObjVertex (position, normal, texture
+coordinate) per unique v/vt/vn combination, with 32-bit triangle list indices. Vertices
+are deduplicated with a hash map, so shared corners are stored once. Faces are grouped by
+material, one ObjSubmesh per material.
+
+Only the common subset of OBJ is supported: v, vn, vt, f (with positive or negative
+indices; polygons are triangulated as fans), usemtl and mtllib. Other statements (o, g,
+s, l, p, curves) are skipped. Normals are not generated; model.hasNormals is false if
+the file has no vn statements, and such files should be loaded with Assimp instead.
+
+*/
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+// Keep windows.h from defining min() and max() macros, which break glm and <algorithm>.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Files smaller than this are parsed on a single thread; starting threads costs more.
+const size_t OBJ_MIN_PARALLEL_FILE_SIZE = 64 * 1024;
+
+struct ObjVertex {
+	float position[3];
+	float normal[3];
+	float texCoord[2];
+};
+
+struct ObjMaterial {
+	string name;
+	float Kambient[4];
+	float Kdiffuse[4];
+	float Kspecular[4];
+	float shininess;
+	string diffuseTexture; // map_Kd, empty if the material has no texture
+};
+
+// A range of model.indices that is drawn with one material.
+struct ObjSubmesh {
+	unsigned int material; // index into model.materials
+	unsigned int indexOffset;
+	unsigned int indexCount;
+};
+
+struct ObjModel {
+	vector<ObjVertex> vertices;
+	vector<unsigned int> indices;
+	vector<ObjSubmesh> submeshes;
+	vector<ObjMaterial> materials;
+	bool hasNormals;
+	bool hasTexCoords;
+};
+
+//---------------------------------------------------------
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+	MappedFile() : fileData(NULL), fileSize(0) {
+#ifdef _WIN32
+		fileHandle = INVALID_HANDLE_VALUE;
+		mappingHandle = NULL;
+#endif
+	}
+
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const char *filename) {
+		close();
+#ifdef _WIN32
+		fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(fileHandle, &size);
+		fileSize = (size_t)size.QuadPart;
+		if (fileSize == 0) {
+			return true; // Nothing to map.
+		}
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle == NULL) {
+			close();
+			return false;
+		}
+		fileData = (const char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = ::open(filename, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			::close(fd);
+			return false;
+		}
+		fileSize = (size_t)info.st_size;
+		if (fileSize == 0) {
+			::close(fd);
+			return true; // Nothing to map.
+		}
+		void *mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd); // The mapping stays valid after the descriptor is closed.
+		if (mapping == MAP_FAILED) {
+			fileSize = 0;
+			return false;
+		}
+		madvise(mapping, fileSize, MADV_SEQUENTIAL);
+		fileData = (const char *)mapping;
+#endif
+		if (fileData == NULL) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (fileData != NULL) UnmapViewOfFile(fileData);
+		if (mappingHandle != NULL) CloseHandle(mappingHandle);
+		if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+		mappingHandle = NULL;
+		fileHandle = INVALID_HANDLE_VALUE;
+#else
+		if (fileData != NULL) munmap((void *)fileData, fileSize);
+#endif
+		fileData = NULL;
+		fileSize = 0;
+	}
+
+	const char *data() const { return fileData; }
+	size_t size() const { return fileSize; }
+
+private:
+	const char *fileData;
+	size_t fileSize;
+#ifdef _WIN32
+	HANDLE fileHandle;
+	HANDLE mappingHandle;
+#endif
+};
+
+//------------------------------------------------
+inline const char *skipObjSpaces(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	return p;
+}
+
+inline const char *skipObjLine(const char *p, const char *end) {
+	while (p < end && *p != '\n') p++;
+	return p < end ? p + 1 : end;
+}
+
+//------------------------------------------------
+// Parse a decimal float such as "-1.5", "0.000001" or "2.5e-3" and advance p past it.
+// The digits are accumulated in a double and scaled by an exact power of ten, which
+// gives the correctly rounded float for the 6-7 digit values written by exporters.
+float parseObjFloat(const char *&p, const char *end) {
+	static const double powersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	p = skipObjSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	double mantissa = 0.0;
+	int exponent = 0;
+	int digits = 0;
+
+	while (p < end && *p >= '0' && *p <= '9') {
+		// Digits after the 18th cannot change a float; only their magnitude counts.
+		if (digits < 18) {
+			mantissa = mantissa * 10.0 + (*p - '0');
+			if (mantissa > 0.0) digits++;
+		} else {
+			exponent++;
+		}
+		p++;
+	}
+
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (digits < 18) {
+				mantissa = mantissa * 10.0 + (*p - '0');
+				exponent--;
+				if (mantissa > 0.0) digits++;
+			}
+			p++;
+		}
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negativeExponent = (*p == '-');
+			p++;
+		}
+		int value = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (value < 10000) value = value * 10 + (*p - '0');
+			p++;
+		}
+		exponent += negativeExponent ? -value : value;
+	}
+
+	double result = mantissa;
+	if (exponent < 0) {
+		result = (exponent >= -22) ? mantissa / powersOf10[-exponent] : mantissa * pow(10.0, exponent);
+	} else if (exponent > 0) {
+		result = (exponent <= 22) ? mantissa * powersOf10[exponent] : mantissa * pow(10.0, exponent);
+	}
+
+	return (float)(negative ? -result : result);
+}
+
+//------------------------------------------------
+// Parse a signed integer (a face index). Returns 0 if there is no number.
+inline int parseObjInt(const char *&p, const char *end) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+	int value = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+	return negative ? -value : value;
+}
+
+//------------------------------------------------
+// Read the rest of the line as a name, without the trailing spaces and '\r'.
+inline string parseObjName(const char *&p, const char *end) {
+	p = skipObjSpaces(p, end);
+	const char *begin = p;
+	while (p < end && *p != '\n' && *p != '\r') p++;
+	const char *last = p;
+	while (last > begin && (last[-1] == ' ' || last[-1] == '\t')) last--;
+	return string(begin, last);
+}
+
+//---------------------------------------------------------
+// Work area of one line range. Pass 1 counts the v/vt/vn statements so that every
+// chunk knows where its vertices go; pass 2 parses them into the shared arrays.
+struct ObjChunk {
+	const char *begin;
+	const char *end;
+
+	unsigned int positionCount, texCoordCount, normalCount;
+	unsigned int positionOffset, texCoordOffset, normalOffset;
+
+	// 3 values (position, texture coordinate, normal; -1 if absent) per triangle corner.
+	vector<int> corners;
+
+	// usemtl statements: the corner at which each material starts.
+	vector<unsigned int> materialStarts;
+	vector<string> materialNames;
+
+	vector<string> materialLibraries;
+};
+
+//------------------------------------------------
+void countObjChunk(ObjChunk &chunk) {
+	chunk.positionCount = chunk.texCoordCount = chunk.normalCount = 0;
+
+	for (const char *p = chunk.begin; p < chunk.end; p = skipObjLine(p, chunk.end)) {
+		p = skipObjSpaces(p, chunk.end);
+		if (p + 1 < chunk.end && p[0] == 'v') {
+			if (p[1] == ' ' || p[1] == '\t') chunk.positionCount++;
+			else if (p[1] == 't') chunk.texCoordCount++;
+			else if (p[1] == 'n') chunk.normalCount++;
+		}
+	}
+}
+
+//------------------------------------------------
+// Convert a 1-based (or negative, relative) OBJ index to a 0-based index.
+inline int resolveObjIndex(int index, unsigned int countSoFar) {
+	if (index > 0) return index - 1;
+	if (index < 0) return (int)countSoFar + index;
+	return -1;
+}
+
+//------------------------------------------------
+void parseObjChunk(ObjChunk &chunk, float *positions, float *texCoords, float *normals) {
+	unsigned int positionIndex = chunk.positionOffset;
+	unsigned int texCoordIndex = chunk.texCoordOffset;
+	unsigned int normalIndex = chunk.normalOffset;
+
+	// Corners of the polygon being triangulated.
+	vector<int> polygon;
+
+	const char *end = chunk.end;
+	for (const char *p = chunk.begin; p < end; p = skipObjLine(p, end)) {
+		p = skipObjSpaces(p, end);
+		if (p >= end) break;
+
+		if (p[0] == 'v' && p + 1 < end) {
+			if (p[1] == ' ' || p[1] == '\t') {
+				p += 1;
+				float *v = &positions[positionIndex++ * 3];
+				v[0] = parseObjFloat(p, end);
+				v[1] = parseObjFloat(p, end);
+				v[2] = parseObjFloat(p, end);
+			} else if (p[1] == 't') {
+				p += 2;
+				float *t = &texCoords[texCoordIndex++ * 2];
+				t[0] = parseObjFloat(p, end);
+				t[1] = parseObjFloat(p, end);
+			} else if (p[1] == 'n') {
+				p += 2;
+				float *n = &normals[normalIndex++ * 3];
+				n[0] = parseObjFloat(p, end);
+				n[1] = parseObjFloat(p, end);
+				n[2] = parseObjFloat(p, end);
+			}
+		} else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+			p += 1;
+			polygon.clear();
+			for (;;) {
+				p = skipObjSpaces(p, end);
+				if (p >= end || *p == '\n' || *p == '\r' || *p == '#') break;
+
+				int v = parseObjInt(p, end);
+				int t = 0, n = 0;
+				if (p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/') t = parseObjInt(p, end);
+					if (p < end && *p == '/') {
+						p++;
+						n = parseObjInt(p, end);
+					}
+				}
+				if (v == 0) break; // malformed corner
+
+				polygon.push_back(resolveObjIndex(v, positionIndex));
+				polygon.push_back(resolveObjIndex(t, texCoordIndex));
+				polygon.push_back(resolveObjIndex(n, normalIndex));
+			}
+
+			// Triangulate the polygon as a fan around its first corner.
+			unsigned int cornerCount = (unsigned int)polygon.size() / 3;
+			for (unsigned int k = 1; k + 1 < cornerCount; k++) {
+				chunk.corners.insert(chunk.corners.end(), &polygon[0], &polygon[0] + 3);
+				chunk.corners.insert(chunk.corners.end(), &polygon[k * 3], &polygon[k * 3] + 6);
+			}
+		} else if (end - p > 7 && strncmp(p, "usemtl", 6) == 0 && (p[6] == ' ' || p[6] == '\t')) {
+			p += 6;
+			chunk.materialStarts.push_back((unsigned int)chunk.corners.size() / 3);
+			chunk.materialNames.push_back(parseObjName(p, end));
+		} else if (end - p > 7 && strncmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t')) {
+			p += 6;
+			chunk.materialLibraries.push_back(parseObjName(p, end));
+		}
+	}
+}
+
+//------------------------------------------------
+// Hash map key of a unique vertex: its position, texture coordinate and normal indices.
+struct ObjCornerKey {
+	int position, texCoord, normal;
+
+	bool operator==(const ObjCornerKey &other) const {
+		return position == other.position && texCoord == other.texCoord && normal == other.normal;
+	}
+};
+
+//---------------------------------------------------------
+// Hash map from ObjCornerKey to vertex index with open addressing (linear probing).
+// It is sized for the worst case up front (every corner unique), so inserting never
+// rehashes and a lookup touches one or two adjacent slots.
+class ObjVertexTable {
+public:
+	explicit ObjVertexTable(size_t maxCount) {
+		size_t capacity = 64;
+		while (capacity < maxCount * 2) capacity *= 2;
+		ObjCornerKey emptyKey = { -1, -1, -1 };
+		keys.assign(capacity, emptyKey);
+		values.resize(capacity);
+		mask = capacity - 1;
+	}
+
+	// Return the index stored for the key. If the key is new, store newIndex,
+	// set inserted to true and return newIndex.
+	unsigned int findOrInsert(const ObjCornerKey &key, unsigned int newIndex, bool &inserted) {
+		size_t h = (size_t)(unsigned int)key.position * 73856093u;
+		h ^= (size_t)(unsigned int)key.texCoord * 19349663u;
+		h ^= (size_t)(unsigned int)key.normal * 83492791u;
+
+		for (size_t slot = h & mask; ; slot = (slot + 1) & mask) {
+			if (keys[slot].position < 0) {
+				keys[slot] = key;
+				values[slot] = newIndex;
+				inserted = true;
+				return newIndex;
+			}
+			if (keys[slot] == key) {
+				inserted = false;
+				return values[slot];
+			}
+		}
+	}
+
+private:
+	vector<ObjCornerKey> keys; // position -1 marks an empty slot
+	vector<unsigned int> values;
+	size_t mask;
+};
+
+//------------------------------------------------
+void setObjColor(float *color, float r, float g, float b) {
+	color[0] = r;
+	color[1] = g;
+	color[2] = b;
+	color[3] = 1.0f;
+}
+
+ObjMaterial defaultObjMaterial(const string &name) {
+	ObjMaterial material;
+	material.name = name;
+	setObjColor(material.Kambient, 0.2f, 0.2f, 0.2f);
+	setObjColor(material.Kdiffuse, 0.8f, 0.8f, 0.8f);
+	setObjColor(material.Kspecular, 0.0f, 0.0f, 0.0f);
+	material.shininess = 0.0f;
+	return material;
+}
+
+//------------------------------------------------
+bool loadMtlFile(const char *filename, vector<ObjMaterial> &materials) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+
+	const char *end = file.data() + file.size();
+	ObjMaterial *current = NULL;
+
+	for (const char *p = file.data(); p < end; p = skipObjLine(p, end)) {
+		p = skipObjSpaces(p, end);
+		if (p >= end) break;
+
+		if (end - p > 7 && strncmp(p, "newmtl", 6) == 0) {
+			p += 6;
+			materials.push_back(defaultObjMaterial(parseObjName(p, end)));
+			current = &materials.back();
+		} else if (current == NULL) {
+			continue;
+		} else if (p + 2 < end && p[0] == 'K' && (p[2] == ' ' || p[2] == '\t')) {
+			float *color = NULL;
+			if (p[1] == 'a') color = current->Kambient;
+			else if (p[1] == 'd') color = current->Kdiffuse;
+			else if (p[1] == 's') color = current->Kspecular;
+			if (color != NULL) {
+				p += 2;
+				float r = parseObjFloat(p, end);
+				float g = parseObjFloat(p, end);
+				float b = parseObjFloat(p, end);
+				setObjColor(color, r, g, b);
+			}
+		} else if (p + 2 < end && p[0] == 'N' && p[1] == 's') {
+			p += 2;
+			current->shininess = parseObjFloat(p, end);
+		} else if (end - p > 7 && strncmp(p, "map_Kd", 6) == 0) {
+			p += 6;
+			current->diffuseTexture = parseObjName(p, end);
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------
+bool parseObjData(const char *data, size_t size, const string &directory, ObjModel &model,
+	unsigned int threadCount = 0) {
+	model.vertices.clear();
+	model.indices.clear();
+	model.submeshes.clear();
+	model.materials.clear();
+	model.hasNormals = false;
+	model.hasTexCoords = false;
+
+	const char *fileEnd = data + size;
+
+	if (threadCount == 0) {
+		threadCount = thread::hardware_concurrency();
+	}
+	if (threadCount == 0 || size < OBJ_MIN_PARALLEL_FILE_SIZE) {
+		threadCount = 1;
+	}
+
+	// Split the file into line ranges of about the same size.
+	vector<ObjChunk> chunks;
+	const char *chunkBegin = data;
+	for (unsigned int c = 0; c < threadCount && chunkBegin < fileEnd; c++) {
+		const char *chunkEnd = (c + 1 == threadCount) ? fileEnd : data + size * (c + 1) / threadCount;
+		if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+		chunkEnd = skipObjLine(chunkEnd == data ? chunkEnd : chunkEnd - 1, fileEnd);
+
+		ObjChunk chunk;
+		chunk.begin = chunkBegin;
+		chunk.end = chunkEnd;
+		chunks.push_back(chunk);
+		chunkBegin = chunkEnd;
+	}
+
+	// Run a pass over every chunk, one thread per chunk (the first on this thread).
+	auto runChunks = [&chunks](void (*pass)(ObjChunk &, float *, float *, float *),
+		float *positions, float *texCoords, float *normals) {
+		vector<thread> workers;
+		for (size_t c = 1; c < chunks.size(); c++) {
+			workers.push_back(thread(pass, ref(chunks[c]), positions, texCoords, normals));
+		}
+		if (!chunks.empty()) {
+			pass(chunks[0], positions, texCoords, normals);
+		}
+		for (size_t w = 0; w < workers.size(); w++) {
+			workers[w].join();
+		}
+	};
+
+	// Pass 1: count the vertex statements of each chunk.
+	runChunks([](ObjChunk &chunk, float *, float *, float *) { countObjChunk(chunk); }, NULL, NULL, NULL);
+
+	unsigned int positionCount = 0, texCoordCount = 0, normalCount = 0;
+	for (size_t c = 0; c < chunks.size(); c++) {
+		chunks[c].positionOffset = positionCount;
+		chunks[c].texCoordOffset = texCoordCount;
+		chunks[c].normalOffset = normalCount;
+		positionCount += chunks[c].positionCount;
+		texCoordCount += chunks[c].texCoordCount;
+		normalCount += chunks[c].normalCount;
+	}
+
+	// Pass 2: parse every chunk straight into its part of the shared arrays.
+	vector<float> positions(positionCount * 3 + 3);
+	vector<float> texCoords(texCoordCount * 2 + 2);
+	vector<float> normals(normalCount * 3 + 3);
+	runChunks(parseObjChunk, &positions[0], &texCoords[0], &normals[0]);
+
+	model.hasNormals = normalCount > 0;
+	model.hasTexCoords = texCoordCount > 0;
+
+	// Read the material libraries, relative to the directory of the OBJ file.
+	for (size_t c = 0; c < chunks.size(); c++) {
+		for (size_t m = 0; m < chunks[c].materialLibraries.size(); m++) {
+			loadMtlFile((directory + chunks[c].materialLibraries[m]).c_str(), model.materials);
+		}
+	}
+
+	// Deduplicate the corners in file order and collect the triangles of each material.
+	size_t cornerCount = 0;
+	for (size_t c = 0; c < chunks.size(); c++) {
+		cornerCount += chunks[c].corners.size() / 3;
+	}
+	ObjVertexTable uniqueVertices(cornerCount);
+	unordered_map<string, unsigned int> materialIndices;
+	for (unsigned int m = 0; m < model.materials.size(); m++) {
+		materialIndices[model.materials[m].name] = m;
+	}
+	vector<vector<unsigned int> > materialTriangles;
+
+	int currentMaterial = -1; // -1 until the first usemtl
+	for (size_t c = 0; c < chunks.size(); c++) {
+		ObjChunk &chunk = chunks[c];
+		unsigned int chunkCorners = (unsigned int)chunk.corners.size() / 3;
+		size_t nextSwitch = 0;
+
+		for (unsigned int k = 0; k + 2 < chunkCorners; k += 3) {
+			while (nextSwitch < chunk.materialStarts.size() && chunk.materialStarts[nextSwitch] <= k) {
+				const string &name = chunk.materialNames[nextSwitch++];
+				if (materialIndices.find(name) == materialIndices.end()) {
+					materialIndices[name] = (unsigned int)model.materials.size();
+					model.materials.push_back(defaultObjMaterial(name));
+				}
+				currentMaterial = materialIndices[name];
+			}
+			if (currentMaterial < 0) {
+				materialIndices[""] = (unsigned int)model.materials.size();
+				currentMaterial = (int)model.materials.size();
+				model.materials.push_back(defaultObjMaterial(""));
+			}
+
+			// Skip triangles that reference a position that does not exist.
+			const int *triangle = &chunk.corners[k * 3];
+			if (triangle[0] < 0 || triangle[0] >= (int)positionCount ||
+				triangle[3] < 0 || triangle[3] >= (int)positionCount ||
+				triangle[6] < 0 || triangle[6] >= (int)positionCount) {
+				continue;
+			}
+
+			if (materialTriangles.size() <= (size_t)currentMaterial) {
+				materialTriangles.resize(currentMaterial + 1);
+			}
+
+			for (unsigned int j = 0; j < 3; j++) {
+				const int *corner = &triangle[j * 3];
+				ObjCornerKey key = { corner[0], corner[1], corner[2] };
+
+				bool inserted;
+				unsigned int vertexIndex = uniqueVertices.findOrInsert(key, (unsigned int)model.vertices.size(), inserted);
+				if (inserted) {
+					ObjVertex vertex;
+					memcpy(vertex.position, &positions[key.position * 3], sizeof(vertex.position));
+					if (key.normal >= 0 && key.normal < (int)normalCount) {
+						memcpy(vertex.normal, &normals[key.normal * 3], sizeof(vertex.normal));
+					} else {
+						vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+					}
+					if (key.texCoord >= 0 && key.texCoord < (int)texCoordCount) {
+						memcpy(vertex.texCoord, &texCoords[key.texCoord * 2], sizeof(vertex.texCoord));
+					} else {
+						vertex.texCoord[0] = vertex.texCoord[1] = 0.0f;
+					}
+					model.vertices.push_back(vertex);
+				}
+
+				materialTriangles[currentMaterial].push_back(vertexIndex);
+			}
+		}
+	}
+
+	for (unsigned int m = 0; m < materialTriangles.size(); m++) {
+		if (materialTriangles[m].empty()) {
+			continue;
+		}
+		ObjSubmesh submesh;
+		submesh.material = m;
+		submesh.indexOffset = (unsigned int)model.indices.size();
+		submesh.indexCount = (unsigned int)materialTriangles[m].size();
+		model.indices.insert(model.indices.end(), materialTriangles[m].begin(), materialTriangles[m].end());
+		model.submeshes.push_back(submesh);
+	}
+
+	return true;
+}
+
+//------------------------------------------------
+bool loadObjFile(const char *filename, ObjModel &model, unsigned int threadCount = 0) {
+	MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+
+	string directory = filename;
+	size_t slash = directory.find_last_of("/\\");
+	directory = (slash == string::npos) ? string() : directory.substr(0, slash + 1);
+
+	return parseObjData(file.data(), file.size(), directory, model, threadCount);
+}
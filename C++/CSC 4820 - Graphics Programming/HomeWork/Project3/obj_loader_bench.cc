@@ -0,0 +1,174 @@
+/*
+John Rucker
+Project 3
+
+OBJ loading benchmark.
+
+Loads each OBJ file with Assimp (aiProcessPreset_TargetRealtime_Quality, as in
+Rucker_proj3.cc) and with loadObjFile() from obj_loader.hpp, on one thread and on
+every core, and reports the best time of several runs together with the number of
+vertices and triangles each loader produced.
+
+Usage: obj_loader_bench [runs] [file.obj ...]
+Without file names, the OBJ files bundled with Project 3 and Project 4 are measured.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "assimp/Importer.hpp"
+#include "assimp/PostProcess.h"
+#include "assimp/Scene.h"
+
+#include "obj_loader.hpp"
+
+using namespace std;
+
+const char* bundledFiles[] = {
+	"simple_box.obj",
+	"monkey_normal.obj",
+	"dog_normal.obj",
+	"bench_normal.obj",
+	"../Project4/square_textured.obj",
+	"../Project4/monkey_texture.obj",
+	"../Project4/g_char.obj"
+};
+
+// Result of the fastest run of one loader.
+struct LoadResult {
+	double milliseconds;
+	size_t vertices;
+	size_t triangles;
+	bool loaded;
+};
+
+double elapsedMilliseconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//------------------------------------------------------
+LoadResult benchmarkAssimp(const char* filename, int runs) {
+	LoadResult result = { 0.0, 0, 0, false };
+
+	for (int run = 0; run < runs; run++) {
+		Assimp::Importer importer;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		const aiScene* scene = importer.ReadFile(filename, aiProcessPreset_TargetRealtime_Quality);
+		double milliseconds = elapsedMilliseconds(start);
+
+		if (!scene) {
+			cout << filename << ": " << importer.GetErrorString() << endl;
+			return result;
+		}
+
+		if (!result.loaded || milliseconds < result.milliseconds) {
+			result.milliseconds = milliseconds;
+		}
+		result.loaded = true;
+		result.vertices = 0;
+		result.triangles = 0;
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+			result.vertices += scene->mMeshes[i]->mNumVertices;
+			result.triangles += scene->mMeshes[i]->mNumFaces;
+		}
+	}
+
+	return result;
+}
+
+//------------------------------------------------------
+LoadResult benchmarkObjLoader(const char* filename, int runs, unsigned int threadCount) {
+	LoadResult result = { 0.0, 0, 0, false };
+
+	for (int run = 0; run < runs; run++) {
+		ObjModel model;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		bool loaded = loadObjFile(filename, model, threadCount);
+		double milliseconds = elapsedMilliseconds(start);
+
+		if (!loaded) {
+			cout << filename << ": cannot be read" << endl;
+			return result;
+		}
+
+		if (!result.loaded || milliseconds < result.milliseconds) {
+			result.milliseconds = milliseconds;
+		}
+		result.loaded = true;
+		result.vertices = model.vertices.size();
+		result.triangles = model.indices.size() / 3;
+	}
+
+	return result;
+}
+
+//-----------------------------------------------
+void printResult(const char* label, const LoadResult& result, double assimpMilliseconds) {
+	cout << "    " << setw(20) << left << label << right
+		<< fixed << setprecision(3) << setw(10) << result.milliseconds << " ms"
+		<< "  vertices " << setw(7) << result.vertices
+		<< "  triangles " << setw(7) << result.triangles;
+	if (assimpMilliseconds > 0.0 && result.milliseconds > 0.0) {
+		cout << "  " << setprecision(1) << assimpMilliseconds / result.milliseconds << "x";
+	}
+	cout << endl;
+}
+
+//------------------------------------------------------------
+// Measure one file with every loader. Returns false on load error.
+bool measureFile(const char* filename, int runs, unsigned int coreCount) {
+	cout << filename << endl;
+
+	LoadResult assimp = benchmarkAssimp(filename, runs);
+	LoadResult serial = benchmarkObjLoader(filename, runs, 1);
+	LoadResult parallel = benchmarkObjLoader(filename, runs, coreCount);
+
+	if (assimp.loaded) {
+		printResult("Assimp", assimp, 0.0);
+	}
+	if (serial.loaded) {
+		printResult("loadObjFile 1 thread", serial, assimp.milliseconds);
+		string label = "loadObjFile " + to_string(coreCount) + " thr";
+		printResult(label.c_str(), parallel, assimp.milliseconds);
+	}
+	cout << endl;
+
+	return assimp.loaded && serial.loaded;
+}
+
+int main(int argc, char* argv[]) {
+	int runs = 5;
+	int firstFile = 1;
+
+	// An optional leading number selects how many times each file is loaded.
+	if (argc > 1 && atoi(argv[1]) > 0) {
+		runs = atoi(argv[1]);
+		firstFile = 2;
+	}
+
+	unsigned int coreCount = thread::hardware_concurrency();
+	if (coreCount == 0) {
+		coreCount = 1;
+	}
+
+	cout << "Best of " << runs << " runs, " << coreCount << " cores" << endl << endl;
+
+	bool allLoaded = true;
+
+	if (firstFile >= argc) {
+		for (unsigned int i = 0; i < sizeof(bundledFiles) / sizeof(bundledFiles[0]); i++) {
+			allLoaded = measureFile(bundledFiles[i], runs, coreCount) && allLoaded;
+		}
+	} else {
+		for (int i = firstFile; i < argc; i++) {
+			allLoaded = measureFile(argv[i], runs, coreCount) && allLoaded;
+		}
+	}
+
+	return allLoaded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,226 @@
+/* This is a utility program that watches shader files and reads them again when they change.
+The following class is provided.
+
+class ShaderFileWatcher {
+	// Start the watcher thread for the given files. Returns false if the files cannot be watched.
+	bool start(const vector<string>& filenames);
+
+	// Stop the watcher thread. Also called by the destructor.
+	void stop();
+
+	// Returns true once after any of the files has been saved. The new contents of all
+	// the files are returned in the order the files were given to start().
+	bool takeChangedSources(vector<string>& sources);
+};
+
+The files are read on the watcher thread, so the main thread never waits for the disk.
+On Linux, inotify reports the changes. Editors often save by writing a new file and
+renaming it over the old one, so the directories are watched rather than the files.
+On other systems, the modification times are checked four times a second.
+
+No OpenGL function is called here; compiling the new sources is up to the caller.
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+class ShaderFileWatcher {
+public:
+	ShaderFileWatcher() : running(false), changed(false) {}
+
+	~ShaderFileWatcher() { stop(); }
+
+	ShaderFileWatcher(const ShaderFileWatcher&) = delete;
+	ShaderFileWatcher& operator=(const ShaderFileWatcher&) = delete;
+
+	//------------------------------------------------
+	bool start(const vector<string>& filenames) {
+		stop();
+
+		files = filenames;
+		modificationTimes.clear();
+		for (unsigned int i = 0; i < files.size(); i++) {
+			modificationTimes.push_back(fileModificationTime(files[i]));
+		}
+
+#ifdef __linux__
+		inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFD < 0) {
+			return false;
+		}
+
+		watchDescriptors.clear();
+		for (unsigned int i = 0; i < files.size(); i++) {
+			int wd = inotify_add_watch(inotifyFD, directoryName(files[i]).c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (wd < 0) {
+				close(inotifyFD);
+				return false;
+			}
+			watchDescriptors.push_back(wd);
+		}
+#endif
+
+		running = true;
+		worker = thread(&ShaderFileWatcher::run, this);
+		return true;
+	}
+
+	//------------------------------------------------
+	void stop() {
+		if (!worker.joinable()) {
+			return;
+		}
+		running = false;
+		worker.join();
+#ifdef __linux__
+		close(inotifyFD);
+#endif
+	}
+
+	//------------------------------------------------
+	bool takeChangedSources(vector<string>& sources) {
+		lock_guard<mutex> lock(sourcesMutex);
+		if (!changed) {
+			return false;
+		}
+		sources.swap(changedSources);
+		changed = false;
+		return true;
+	}
+
+private:
+	//------------------------------------------------
+	// Watcher thread. Waits for a change, then reads all the files and publishes them.
+	void run() {
+		while (running) {
+			if (!waitForChange()) {
+				continue;
+			}
+
+			// An editor may save in several steps. Wait until the files are quiet.
+			this_thread::sleep_for(chrono::milliseconds(50));
+			while (running && waitForChange()) {
+				this_thread::sleep_for(chrono::milliseconds(50));
+			}
+
+			vector<string> sources(files.size());
+			bool complete = true;
+			for (unsigned int i = 0; i < files.size(); i++) {
+				if (!readFile(files[i], sources[i]) || sources[i].empty()) {
+					complete = false; // The file is missing or still being written.
+				}
+			}
+			if (!complete) {
+				continue;
+			}
+
+			lock_guard<mutex> lock(sourcesMutex);
+			changedSources.swap(sources);
+			changed = true;
+		}
+	}
+
+#ifdef __linux__
+	//------------------------------------------------
+	// Wait up to 250 ms for an inotify event about one of the files.
+	bool waitForChange() {
+		pollfd fd = { inotifyFD, POLLIN, 0 };
+		if (poll(&fd, 1, 250) <= 0) {
+			return false;
+		}
+
+		bool fileChanged = false;
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(inotifyFD, buffer, sizeof(buffer))) > 0) {
+			for (char* p = buffer; p < buffer + length; ) {
+				const inotify_event* event = (const inotify_event*)p;
+				for (unsigned int i = 0; i < files.size(); i++) {
+					if (event->wd == watchDescriptors[i] && event->len > 0 && baseName(files[i]) == event->name) {
+						fileChanged = true;
+					}
+				}
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+		return fileChanged;
+	}
+#else
+	//------------------------------------------------
+	// Check the modification times of the files every 250 ms.
+	bool waitForChange() {
+		this_thread::sleep_for(chrono::milliseconds(250));
+
+		bool fileChanged = false;
+		for (unsigned int i = 0; i < files.size(); i++) {
+			time_t modified = fileModificationTime(files[i]);
+			if (modified != modificationTimes[i]) {
+				modificationTimes[i] = modified;
+				fileChanged = true;
+			}
+		}
+		return fileChanged;
+	}
+#endif
+
+	static time_t fileModificationTime(const string& filename) {
+		struct stat info;
+		if (stat(filename.c_str(), &info) != 0) {
+			return 0;
+		}
+		return info.st_mtime;
+	}
+
+	static bool readFile(const string& filename, string& contents) {
+		ifstream file(filename.c_str());
+		if (!file.is_open()) {
+			return false;
+		}
+		stringstream buffer;
+		buffer << file.rdbuf();
+		contents = buffer.str();
+		return true;
+	}
+
+	static string directoryName(const string& filename) {
+		size_t slash = filename.find_last_of("/\\");
+		return slash == string::npos ? string(".") : filename.substr(0, slash);
+	}
+
+	static string baseName(const string& filename) {
+		size_t slash = filename.find_last_of("/\\");
+		return slash == string::npos ? filename : filename.substr(slash + 1);
+	}
+
+	vector<string> files;
+	vector<time_t> modificationTimes;
+	thread worker;
+	atomic<bool> running;
+
+	mutex sourcesMutex;
+	vector<string> changedSources; // guarded by sourcesMutex
+	bool changed; // guarded by sourcesMutex
+
+#ifdef __linux__
+	int inotifyFD;
+	vector<int> watchDescriptors; // one per file
+#endif
+};
@@ -0,0 +1,178 @@
+/* This is a utility program that packs vertex attributes into smaller GPU formats.
+The following functions are provided.
+
+// Use 16-bit indices when every vertex of the mesh can be addressed with them.
+bool canUseShortIndices(unsigned int vertexCount);
+void narrowIndices(const unsigned int *indices, unsigned int indexCount, unsigned short *shortIndices);
+
+// Encode a unit normal into two signed normalized 16-bit values (octahedral mapping).
+// Decode in the vertex shader with octahedralDecode().
+void octahedralEncode(const float *normal, short *encoded);
+
+// Quantize positions to unsigned normalized 16-bit values relative to the bounding box.
+// The vertex shader restores them with position = positionOffset + vPos * positionScale.
+void quantizePositions(const float *positions, unsigned int vertexCount,
+	unsigned short *quantized, float *positionScale, float *positionOffset);
+
+// Convert a float to an IEEE half float, or to an unsigned normalized 16-bit value.
+unsigned short floatToHalf(float value);
+unsigned short floatToUnorm16(float value);
+
+// Encode 2D texture coordinates as half floats (for UVs outside [0, 1], e.g. GL_REPEAT)
+// or as unsigned normalized 16-bit values (for UVs inside [0, 1]).
+void encodeTexCoords(const float *texCoords, unsigned int vertexCount, unsigned short *encoded,
+	bool useHalfFloat);
+
+Positions are stored as 4 components (the 4th is padding) so that every vertex starts on a
+4-byte boundary, as recommended for vertex fetch.
+
+*/
+
+#include <cmath>
+#include <cstring>
+
+// Largest vertex count that can be addressed by GL_UNSIGNED_SHORT indices.
+const unsigned int MAX_SHORT_INDEX_VERTICES = 65536;
+
+//------------------------------------------------
+bool canUseShortIndices(unsigned int vertexCount) {
+	return vertexCount <= MAX_SHORT_INDEX_VERTICES;
+}
+
+//------------------------------------------------
+void narrowIndices(const unsigned int *indices, unsigned int indexCount, unsigned short *shortIndices) {
+	for (unsigned int i = 0; i < indexCount; i++) {
+		shortIndices[i] = (unsigned short)indices[i];
+	}
+}
+
+//------------------------------------------------
+// Convert a float in [-1, 1] to a signed normalized 16-bit value.
+short floatToSnorm16(float value) {
+	if (value > 1.0f) value = 1.0f;
+	if (value < -1.0f) value = -1.0f;
+	return (short)(value * 32767.0f + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+//------------------------------------------------
+// Convert a float in [0, 1] to an unsigned normalized 16-bit value.
+unsigned short floatToUnorm16(float value) {
+	if (value > 1.0f) value = 1.0f;
+	if (value < 0.0f) value = 0.0f;
+	return (unsigned short)(value * 65535.0f + 0.5f);
+}
+
+//------------------------------------------------
+// Convert a float to a half float with round-to-nearest. Values that are too large
+// become infinity and values that are too small become (signed) zero.
+unsigned short floatToHalf(float value) {
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = bits & 0x7fffff;
+
+	if (((bits >> 23) & 0xff) == 0xff) {
+		// Infinity or NaN
+		return (unsigned short)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+
+	if (exponent >= 31) {
+		return (unsigned short)(sign | 0x7c00); // overflow to infinity
+	}
+
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return (unsigned short)sign; // underflow to zero
+		}
+		// Denormalized half float
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - exponent;
+		unsigned int halfMantissa = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) {
+			halfMantissa++;
+		}
+		return (unsigned short)(sign | halfMantissa);
+	}
+
+	unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000) {
+		half++; // round; a carry into the exponent is still the correct result
+	}
+	return (unsigned short)half;
+}
+
+//------------------------------------------------
+// Octahedral normal encoding: project the normal onto the octahedron |x|+|y|+|z| = 1
+// and fold the lower hemisphere over the diagonals.
+void octahedralEncode(const float *normal, short *encoded) {
+	float x = normal[0], y = normal[1], z = normal[2];
+	float sum = fabs(x) + fabs(y) + fabs(z);
+
+	if (sum > 0.0f) {
+		x /= sum;
+		y /= sum;
+		z /= sum;
+	}
+
+	if (z < 0.0f) {
+		float foldedX = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = floatToSnorm16(x);
+	encoded[1] = floatToSnorm16(y);
+}
+
+//------------------------------------------------
+// positions: 3 floats per vertex. quantized: 4 unsigned shorts per vertex.
+// positionScale and positionOffset: 3 floats each.
+void quantizePositions(const float *positions, unsigned int vertexCount,
+	unsigned short *quantized, float *positionScale, float *positionOffset) {
+
+	float minCorner[3] = {0.0f, 0.0f, 0.0f};
+	float maxCorner[3] = {0.0f, 0.0f, 0.0f};
+
+	if (vertexCount > 0) {
+		memcpy(minCorner, positions, sizeof(minCorner));
+		memcpy(maxCorner, positions, sizeof(maxCorner));
+	}
+
+	// Compute the axis-aligned bounding box of the mesh.
+	for (unsigned int v = 1; v < vertexCount; v++) {
+		for (int k = 0; k < 3; k++) {
+			float p = positions[v * 3 + k];
+			if (p < minCorner[k]) minCorner[k] = p;
+			if (p > maxCorner[k]) maxCorner[k] = p;
+		}
+	}
+
+	for (int k = 0; k < 3; k++) {
+		positionOffset[k] = minCorner[k];
+		positionScale[k] = maxCorner[k] - minCorner[k];
+	}
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		for (int k = 0; k < 3; k++) {
+			float normalized = 0.0f;
+			if (positionScale[k] > 0.0f) {
+				normalized = (positions[v * 3 + k] - positionOffset[k]) / positionScale[k];
+			}
+			quantized[v * 4 + k] = floatToUnorm16(normalized);
+		}
+		quantized[v * 4 + 3] = 0;
+	}
+}
+
+//------------------------------------------------
+// texCoords: 2 floats per vertex. encoded: 2 unsigned shorts per vertex.
+void encodeTexCoords(const float *texCoords, unsigned int vertexCount, unsigned short *encoded,
+	bool useHalfFloat) {
+
+	for (unsigned int i = 0; i < vertexCount * 2; i++) {
+		encoded[i] = useHalfFloat ? floatToHalf(texCoords[i]) : floatToUnorm16(texCoords[i]);
+	}
+}
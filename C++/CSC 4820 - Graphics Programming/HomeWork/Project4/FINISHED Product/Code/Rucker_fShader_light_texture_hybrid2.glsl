@@ -1,19 +1,139 @@
 #version 330
 
+// The C++ program inserts "#define TEXTURE_COUNT n" after the #version line (see
+// shader_permutation.hpp), where n is the number of textures the mesh uses. Only the
+// samplers of that variant are declared and sampled.
+// It also inserts "#define TEXTURE_PATH p" for the way the textures are reached:
+// 0 = one sampler2D per texture unit, 1 = layers of one texture array,
+// 2 = GL_ARB_bindless_texture handles set as the sampler uniforms,
+// 3 = textureMap0 is a virtual texture (see virtual_texture.hpp), the others as in 0.
+// With "#define VT_FEEDBACK 1", the shader writes the virtual texture pages the
+// pixel needs instead of a color.
+#ifndef TEXTURE_COUNT
+#define TEXTURE_COUNT 3
+#endif
+#ifndef TEXTURE_PATH
+#define TEXTURE_PATH 0
+#endif
+
+#if TEXTURE_PATH == 2
+#extension GL_ARB_bindless_texture : require
+#define SAMPLER_LAYOUT layout(bindless_sampler)
+#else
+#define SAMPLER_LAYOUT
+#endif
+
 in vec2 textureCoord;
 
-uniform sampler2D textureMap0;
-uniform sampler2D textureMap1;
-uniform sampler2D textureMap2;
+#if TEXTURE_PATH == 1
+// textureLayers holds the layers of textureMap0, textureMap1, and textureMap2.
+// The array repeats, so textureMap2 is clamped here, half a texel from the edge.
+uniform sampler2DArray textureArray;
+uniform ivec3 textureLayers;
+
+vec2 clampToEdge(vec2 uv) {
+    vec2 halfTexel = 0.5 / vec2(textureSize(textureArray, 0).xy);
+    return clamp(uv, halfTexel, 1.0 - halfTexel);
+}
+
+#define SAMPLE_TEXTURE0(uv) texture(textureArray, vec3(uv, textureLayers.x))
+#define SAMPLE_TEXTURE1(uv) texture(textureArray, vec3(uv, textureLayers.y))
+#define SAMPLE_TEXTURE2(uv) texture(textureArray, vec3(clampToEdge(uv), textureLayers.z))
+#else
+#if TEXTURE_COUNT >= 1 && TEXTURE_PATH != 3
+SAMPLER_LAYOUT uniform sampler2D textureMap0;
+#endif
+#if TEXTURE_COUNT >= 2
+SAMPLER_LAYOUT uniform sampler2D textureMap1;
+#endif
+#if TEXTURE_COUNT >= 3
+SAMPLER_LAYOUT uniform sampler2D textureMap2;
+#endif
+
+#define SAMPLE_TEXTURE0(uv) texture(textureMap0, uv)
+#define SAMPLE_TEXTURE1(uv) texture(textureMap1, uv)
+#define SAMPLE_TEXTURE2(uv) texture(textureMap2, uv)
+#endif
+
+#if TEXTURE_PATH == 3
+// The pages of the virtual texture are in vtCache, 130 x 130 texels per slot: a page of
+// 128 x 128 texels and a border of 1. vtIndirection has one texel per page and one mipmap
+// level per page level. Each texel holds the slot (x, y) of the page and the level of the
+// page in the slot, which is coarser than the wanted level until the page is loaded.
+uniform sampler2D vtCache;
+uniform sampler2D vtIndirection;
+uniform vec2 vtImageSize; // texels of level 0
+uniform vec2 vtPageGrid; // pages of level 0
+uniform float vtMaxLevel;
+uniform float vtLevelBias;
+
+const float VT_PAGE_SIZE = 128.0;
+const float VT_SLOT_SIZE = 130.0;
+
+// The mipmap level of the texture coordinates, from their change between pixels
+float virtualTextureLevel(vec2 uv) {
+    vec2 dx = dFdx(uv * vtImageSize);
+    vec2 dy = dFdy(uv * vtImageSize);
+    float level = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtLevelBias;
+    return clamp(floor(level), 0.0, vtMaxLevel);
+}
+
+// Texels of a level, like the mipmaps: max(1, size >> level)
+vec2 virtualLevelSize(float level) {
+    return max(floor(vtImageSize / exp2(level)), vec2(1.0));
+}
+
+// The page of a texture coordinate at a level. The texture repeats.
+vec2 virtualPage(vec2 uv, float level) {
+    vec2 pages = max(vtPageGrid / exp2(level), vec2(1.0));
+    return min(floor(fract(uv) * virtualLevelSize(level) / VT_PAGE_SIZE), pages - 1.0);
+}
+
+vec4 sampleVirtualTexture(vec2 uv) {
+    float level = virtualTextureLevel(uv);
+    vec4 entry = floor(texelFetch(vtIndirection, ivec2(virtualPage(uv, level)), int(level)) * 255.0 + 0.5);
+
+    // The position in the page that is in the slot, at the level of that page
+    vec2 texel = fract(uv) * virtualLevelSize(entry.z);
+    vec2 inPage = texel - VT_PAGE_SIZE * floor(texel / VT_PAGE_SIZE);
+    vec2 cacheTexel = entry.xy * VT_SLOT_SIZE + 1.0 + inPage;
+    return textureLod(vtCache, cacheTexel / vec2(textureSize(vtCache, 0)), 0.0);
+}
+
+// The page and level this pixel needs, for the feedback pass
+vec4 virtualTextureFeedback(vec2 uv) {
+    float level = virtualTextureLevel(uv);
+    return vec4(virtualPage(uv, level), level, 255.0) / 255.0;
+}
+
+#undef SAMPLE_TEXTURE0
+#define SAMPLE_TEXTURE0(uv) sampleVirtualTexture(uv)
+#endif
 
 out vec4 fragColor;
 
 void main() {
 
+#if TEXTURE_PATH == 3 && defined(VT_FEEDBACK)
+    fragColor = virtualTextureFeedback(textureCoord);
+    return;
+#endif
+
+#if TEXTURE_COUNT == 0
+    // The mesh has no texture.
+    fragColor = vec4(1.0, 1.0, 1.0, 1.0);
+
+#elif TEXTURE_COUNT == 1
+    fragColor = SAMPLE_TEXTURE0(textureCoord);
+
+#elif TEXTURE_COUNT == 2
+    fragColor = SAMPLE_TEXTURE0(textureCoord) * SAMPLE_TEXTURE1(textureCoord);
+
+#else
 // retrieve color from each texture
-    vec4 textureColor1 = texture2D(textureMap0, textureCoord);
-    vec4 textureColor2 = texture2D(textureMap1, textureCoord);
-    vec4 textureColor3 = texture2D(textureMap2, textureCoord);
+    vec4 textureColor1 = SAMPLE_TEXTURE0(textureCoord);
+    vec4 textureColor2 = SAMPLE_TEXTURE1(textureCoord);
+    vec4 textureColor3 = SAMPLE_TEXTURE2(textureCoord);
 	
 // Combine the two texture colors
 // Depending on the texture colors, you may multiply, add,
@@ -30,5 +150,5 @@ void main() {
 #else
     gl_FragColor = textureColor1 * textureColor2 * textureColor3;
 #endif
+#endif
 }
-
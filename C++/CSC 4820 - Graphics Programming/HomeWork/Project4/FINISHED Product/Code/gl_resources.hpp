@@ -0,0 +1,470 @@
+/* This is a utility program that owns OpenGL objects and keeps track of the GPU memory they use.
+The following classes and functions are provided.
+
+// RAII handles. Each handle owns one OpenGL object and deletes it in its destructor.
+// Handles can be moved (e.g. stored in a vector) but not copied.
+class GpuBuffer;       // vertex, index, uniform, texture, or pixel buffer object
+class GpuVertexArray;  // vertex array object
+class GpuTexture;      // texture object, e.g. created by SOIL
+class GpuFramebuffer;  // framebuffer object
+class GpuQuery;        // query object, e.g. for occlusion queries
+class GpuProgram;      // shader program object
+
+// The resource manager counts the live objects and bytes of each category.
+// Call this function to print the counters, e.g. after a scene is unloaded and reloaded.
+void printGpuResourceReport(const char* title);
+
+// Number of live objects and bytes of all categories. Both are 0 when everything has been released.
+unsigned int liveGpuObjectCount();
+size_t liveGpuBytes();
+
+Texture sizes are queried from OpenGL (every mipmap level is counted), and program sizes are
+the program binary length when GL_ARB_get_program_binary is available.
+
+*/
+
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+enum GpuResourceCategory {
+	GPU_VERTEX_BUFFER,
+	GPU_INDEX_BUFFER,
+	GPU_UNIFORM_BUFFER,
+	GPU_TEXTURE_BUFFER, // the storage of a buffer texture (GL_TEXTURE_BUFFER)
+	GPU_PIXEL_BUFFER,
+	GPU_VERTEX_ARRAY,
+	GPU_TEXTURE,
+	GPU_FRAMEBUFFER,
+	GPU_QUERY,
+	GPU_PROGRAM,
+	GPU_RESOURCE_CATEGORY_COUNT
+};
+
+const char* gpuResourceCategoryNames[GPU_RESOURCE_CATEGORY_COUNT] = {
+	"vertex buffers",
+	"index buffers",
+	"uniform buffers",
+	"texture buffers",
+	"pixel buffers",
+	"vertex arrays",
+	"textures",
+	"framebuffers",
+	"queries",
+	"programs"
+};
+
+//---------------------------------------------------------
+// The resource manager: live object and byte counters for each category.
+// Only the handle classes below change these counters.
+struct GpuResourceManager {
+	unsigned int liveObjects[GPU_RESOURCE_CATEGORY_COUNT];
+	size_t liveBytes[GPU_RESOURCE_CATEGORY_COUNT];
+	size_t peakBytes;
+};
+
+GpuResourceManager gpuResources = { {0}, {0}, 0 };
+
+void trackGpuObject(GpuResourceCategory category, int objectDelta, long long byteDelta) {
+	gpuResources.liveObjects[category] += objectDelta;
+	gpuResources.liveBytes[category] = (size_t)((long long)gpuResources.liveBytes[category] + byteDelta);
+
+	size_t total = 0;
+	for (int c = 0; c < GPU_RESOURCE_CATEGORY_COUNT; c++) {
+		total += gpuResources.liveBytes[c];
+	}
+	if (total > gpuResources.peakBytes) {
+		gpuResources.peakBytes = total;
+	}
+}
+
+unsigned int liveGpuObjectCount() {
+	unsigned int count = 0;
+	for (int c = 0; c < GPU_RESOURCE_CATEGORY_COUNT; c++) {
+		count += gpuResources.liveObjects[c];
+	}
+	return count;
+}
+
+size_t liveGpuBytes() {
+	size_t bytes = 0;
+	for (int c = 0; c < GPU_RESOURCE_CATEGORY_COUNT; c++) {
+		bytes += gpuResources.liveBytes[c];
+	}
+	return bytes;
+}
+
+void printGpuResourceReport(const char* title) {
+	cout << "---------- GPU resources: " << title << " ----------" << endl;
+	for (int c = 0; c < GPU_RESOURCE_CATEGORY_COUNT; c++) {
+		cout << setw(16) << left << gpuResourceCategoryNames[c] << right
+			<< setw(6) << gpuResources.liveObjects[c] << " objects "
+			<< setw(12) << gpuResources.liveBytes[c] << " bytes" << endl;
+	}
+	cout << setw(16) << left << "total" << right
+		<< setw(6) << liveGpuObjectCount() << " objects "
+		<< setw(12) << liveGpuBytes() << " bytes (peak " << gpuResources.peakBytes << ")" << endl;
+}
+
+//---------------------------------------------------------
+// Buffer object. The category decides where its bytes are counted.
+class GpuBuffer {
+public:
+	GpuBuffer() : bufferID(0), category(GPU_VERTEX_BUFFER), size(0) {}
+
+	explicit GpuBuffer(GpuResourceCategory bufferCategory) : bufferID(0), category(bufferCategory), size(0) {
+		glGenBuffers(1, &bufferID);
+		trackGpuObject(category, 1, 0);
+	}
+
+	~GpuBuffer() { release(); }
+
+	GpuBuffer(const GpuBuffer&) = delete;
+	GpuBuffer& operator=(const GpuBuffer&) = delete;
+
+	GpuBuffer(GpuBuffer&& other) : bufferID(other.bufferID), category(other.category), size(other.size) {
+		other.bufferID = 0;
+		other.size = 0;
+	}
+
+	GpuBuffer& operator=(GpuBuffer&& other) {
+		if (this != &other) {
+			release();
+			bufferID = other.bufferID;
+			category = other.category;
+			size = other.size;
+			other.bufferID = 0;
+			other.size = 0;
+		}
+		return *this;
+	}
+
+	// Bind the buffer and (re)allocate its storage with glBufferData().
+	void upload(GLenum target, GLsizeiptr dataSize, const void* data, GLenum usage) {
+		glBindBuffer(target, bufferID);
+		glBufferData(target, dataSize, data, usage);
+		trackGpuObject(category, 0, (long long)dataSize - (long long)size);
+		size = (size_t)dataSize;
+	}
+
+	void release() {
+		if (bufferID != 0) {
+			glDeleteBuffers(1, &bufferID);
+			trackGpuObject(category, -1, -(long long)size);
+			bufferID = 0;
+			size = 0;
+		}
+	}
+
+	GLuint id() const { return bufferID; }
+	size_t bytes() const { return size; }
+
+private:
+	GLuint bufferID;
+	GpuResourceCategory category;
+	size_t size;
+};
+
+//---------------------------------------------------------
+// Vertex array object. VAOs only hold state, so no bytes are counted.
+class GpuVertexArray {
+public:
+	GpuVertexArray() : vaoID(0) {}
+
+	// Pass true to create the VAO.
+	explicit GpuVertexArray(bool create) : vaoID(0) {
+		if (create) {
+			glGenVertexArrays(1, &vaoID);
+			trackGpuObject(GPU_VERTEX_ARRAY, 1, 0);
+		}
+	}
+
+	~GpuVertexArray() { release(); }
+
+	GpuVertexArray(const GpuVertexArray&) = delete;
+	GpuVertexArray& operator=(const GpuVertexArray&) = delete;
+
+	GpuVertexArray(GpuVertexArray&& other) : vaoID(other.vaoID) {
+		other.vaoID = 0;
+	}
+
+	GpuVertexArray& operator=(GpuVertexArray&& other) {
+		if (this != &other) {
+			release();
+			vaoID = other.vaoID;
+			other.vaoID = 0;
+		}
+		return *this;
+	}
+
+	void release() {
+		if (vaoID != 0) {
+			glDeleteVertexArrays(1, &vaoID);
+			trackGpuObject(GPU_VERTEX_ARRAY, -1, 0);
+			vaoID = 0;
+		}
+	}
+
+	GLuint id() const { return vaoID; }
+
+private:
+	GLuint vaoID;
+};
+
+//---------------------------------------------------------
+// Size of a texture in bytes, summed over all mipmap levels. A buffer texture has no
+// storage of its own; its bytes are counted with its GpuBuffer.
+size_t queryTextureBytes(GLenum target, GLuint textureID) {
+	if (target == GL_TEXTURE_BUFFER) {
+		return 0;
+	}
+
+	GLint previous = 0;
+	glGetIntegerv(target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(target, textureID);
+
+	size_t total = 0;
+	for (GLint level = 0; level < 16; level++) {
+		GLint width = 0, height = 0, depth = 1, compressed = 0;
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+		if (width == 0 || height == 0) {
+			break;
+		}
+		if (target == GL_TEXTURE_2D_ARRAY) {
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+		}
+
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			GLint compressedSize = 0;
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+			total += compressedSize;
+		} else {
+			// Add up the bits of each channel to get the size of a texel.
+			GLint bits = 0, channelBits = 0;
+			GLenum sizeQueries[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+				GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE };
+			for (int q = 0; q < 5; q++) {
+				glGetTexLevelParameteriv(target, level, sizeQueries[q], &channelBits);
+				bits += channelBits;
+			}
+			total += (size_t)width * height * depth * ((bits + 7) / 8);
+		}
+	}
+
+	glBindTexture(target, previous);
+	return total;
+}
+
+//---------------------------------------------------------
+// Texture object. A handle can take over a texture created elsewhere (e.g. by SOIL).
+class GpuTexture {
+public:
+	GpuTexture() : textureID(0), target(GL_TEXTURE_2D), size(0) {}
+
+	// Take ownership of an existing texture. Its size is queried from OpenGL.
+	GpuTexture(GLenum textureTarget, GLuint existingTextureID) : textureID(existingTextureID), target(textureTarget), size(0) {
+		if (textureID != 0) {
+			size = queryTextureBytes(target, textureID);
+			trackGpuObject(GPU_TEXTURE, 1, (long long)size);
+		}
+	}
+
+	~GpuTexture() { release(); }
+
+	GpuTexture(const GpuTexture&) = delete;
+	GpuTexture& operator=(const GpuTexture&) = delete;
+
+	GpuTexture(GpuTexture&& other) : textureID(other.textureID), target(other.target), size(other.size) {
+		other.textureID = 0;
+		other.size = 0;
+	}
+
+	GpuTexture& operator=(GpuTexture&& other) {
+		if (this != &other) {
+			release();
+			textureID = other.textureID;
+			target = other.target;
+			size = other.size;
+			other.textureID = 0;
+			other.size = 0;
+		}
+		return *this;
+	}
+
+	// Query the size again after the texture images have been changed.
+	void updateSize() {
+		if (textureID != 0) {
+			size_t newSize = queryTextureBytes(target, textureID);
+			trackGpuObject(GPU_TEXTURE, 0, (long long)newSize - (long long)size);
+			size = newSize;
+		}
+	}
+
+	void release() {
+		if (textureID != 0) {
+			glDeleteTextures(1, &textureID);
+			trackGpuObject(GPU_TEXTURE, -1, -(long long)size);
+			textureID = 0;
+			size = 0;
+		}
+	}
+
+	GLuint id() const { return textureID; }
+	size_t bytes() const { return size; }
+
+private:
+	GLuint textureID;
+	GLenum target;
+	size_t size;
+};
+
+//---------------------------------------------------------
+// Framebuffer object. Its attachments are owned by their own handles, so no bytes are counted.
+class GpuFramebuffer {
+public:
+	GpuFramebuffer() : framebufferID(0) {}
+
+	// Pass true to create the framebuffer.
+	explicit GpuFramebuffer(bool create) : framebufferID(0) {
+		if (create) {
+			glGenFramebuffers(1, &framebufferID);
+			trackGpuObject(GPU_FRAMEBUFFER, 1, 0);
+		}
+	}
+
+	~GpuFramebuffer() { release(); }
+
+	GpuFramebuffer(const GpuFramebuffer&) = delete;
+	GpuFramebuffer& operator=(const GpuFramebuffer&) = delete;
+
+	GpuFramebuffer(GpuFramebuffer&& other) : framebufferID(other.framebufferID) {
+		other.framebufferID = 0;
+	}
+
+	GpuFramebuffer& operator=(GpuFramebuffer&& other) {
+		if (this != &other) {
+			release();
+			framebufferID = other.framebufferID;
+			other.framebufferID = 0;
+		}
+		return *this;
+	}
+
+	void release() {
+		if (framebufferID != 0) {
+			glDeleteFramebuffers(1, &framebufferID);
+			trackGpuObject(GPU_FRAMEBUFFER, -1, 0);
+			framebufferID = 0;
+		}
+	}
+
+	GLuint id() const { return framebufferID; }
+
+private:
+	GLuint framebufferID;
+};
+
+//---------------------------------------------------------
+// Query object. Queries only hold a result, so no bytes are counted.
+class GpuQuery {
+public:
+	GpuQuery() : queryID(0) {}
+
+	// Pass true to create the query.
+	explicit GpuQuery(bool create) : queryID(0) {
+		if (create) {
+			glGenQueries(1, &queryID);
+			trackGpuObject(GPU_QUERY, 1, 0);
+		}
+	}
+
+	~GpuQuery() { release(); }
+
+	GpuQuery(const GpuQuery&) = delete;
+	GpuQuery& operator=(const GpuQuery&) = delete;
+
+	GpuQuery(GpuQuery&& other) : queryID(other.queryID) {
+		other.queryID = 0;
+	}
+
+	GpuQuery& operator=(GpuQuery&& other) {
+		if (this != &other) {
+			release();
+			queryID = other.queryID;
+			other.queryID = 0;
+		}
+		return *this;
+	}
+
+	void release() {
+		if (queryID != 0) {
+			glDeleteQueries(1, &queryID);
+			trackGpuObject(GPU_QUERY, -1, 0);
+			queryID = 0;
+		}
+	}
+
+	GLuint id() const { return queryID; }
+
+private:
+	GLuint queryID;
+};
+
+//---------------------------------------------------------
+// Shader program object. Call glDeleteShader() on the attached shaders after linking;
+// they are then released together with the program.
+class GpuProgram {
+public:
+	GpuProgram() : programID(0), size(0) {}
+
+	// Take ownership of a program created with glCreateProgram(). Call after glLinkProgram().
+	explicit GpuProgram(GLuint existingProgramID) : programID(existingProgramID), size(0) {
+		if (programID != 0) {
+			if (GLEW_ARB_get_program_binary) {
+				GLint binaryLength = 0;
+				glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+				size = binaryLength;
+			}
+			trackGpuObject(GPU_PROGRAM, 1, (long long)size);
+		}
+	}
+
+	~GpuProgram() { release(); }
+
+	GpuProgram(const GpuProgram&) = delete;
+	GpuProgram& operator=(const GpuProgram&) = delete;
+
+	GpuProgram(GpuProgram&& other) : programID(other.programID), size(other.size) {
+		other.programID = 0;
+		other.size = 0;
+	}
+
+	GpuProgram& operator=(GpuProgram&& other) {
+		if (this != &other) {
+			release();
+			programID = other.programID;
+			size = other.size;
+			other.programID = 0;
+			other.size = 0;
+		}
+		return *this;
+	}
+
+	void release() {
+		if (programID != 0) {
+			glDeleteProgram(programID);
+			trackGpuObject(GPU_PROGRAM, -1, -(long long)size);
+			programID = 0;
+			size = 0;
+		}
+	}
+
+	GLuint id() const { return programID; }
+
+private:
+	GLuint programID;
+	size_t size;
+};
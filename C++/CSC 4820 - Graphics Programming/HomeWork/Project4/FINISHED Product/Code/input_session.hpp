@@ -0,0 +1,290 @@
+/* This is a utility program that records the input of a session (keys, special keys, and
+window sizes, as the GLUT callbacks receive them) with the frame each one arrived in, and
+plays it back frame by frame. A replayed session draws the same frames from the same input
+on every build, so the frame times of two builds can be compared, and the image hash of
+every frame shows whether a change altered what is drawn. Include it after GL/glew.h.
+The following enum, struct, classes, and function are provided.
+
+enum InputEventType { INPUT_KEY, INPUT_SPECIAL_KEY, INPUT_RESHAPE };
+
+// key, x, y for the keys; width, height, 0 for a reshape
+struct InputEvent {
+	unsigned long long frame; // the number of frames drawn before the event arrived
+	double milliseconds;      // since the recording started, for reference
+	InputEventType type;
+	int a, b, c;
+};
+
+class InputRecorder {
+	bool open(const char *path);
+	bool isOpen() const;
+	void record(InputEventType type, int a, int b, int c); // in the callbacks
+	void frameDrawn();                                      // after each swap
+	void close();                                           // writes the end of the session
+};
+
+class InputPlayer {
+	bool open(const char *path);
+	bool isOpen() const;
+
+	// The next event of the current frame, in the recorded order. Call it until it returns
+	// false at the start of each frame, and pass the events to the callbacks.
+	bool nextEvent(InputEvent &event);
+
+	// After each frame is drawn, before the swap and before any readback: stamps the
+	// frame time.
+	void frameDrawn();
+
+	// Optional, after frameDrawn(): the image hash of the frame. The clock of the next
+	// frame starts after the hash, so the readback is not part of the frame times.
+	void frameHashed(unsigned long long imageHash);
+
+	bool finished() const; // every recorded frame has been drawn
+	unsigned long long frame() const;
+
+	void report(std::ostream &out) const;        // frame time percentiles
+	bool writeFrames(const char *path) const;    // frame, milliseconds, hash (if hashed) per line
+};
+
+// FNV-1a hash of the pixels of the viewport in the back buffer.
+unsigned long long framebufferHash();
+
+The session file is text, one event per line: "frame milliseconds type a b c", with the
+type key, special, or reshape, and a last line "end frame". The frames are counted by the
+program, so it decides which frames belong to the session (e.g. not those drawn while a
+scene loads). Work that depends on the clock instead of the frame count must be made to
+step once per frame during a replay, or the images will differ between runs. Hash the
+frames only when the hashes are wanted: the readback waits for the GPU, so every frame after
+it starts with an idle GPU.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+enum InputEventType { INPUT_KEY, INPUT_SPECIAL_KEY, INPUT_RESHAPE };
+
+const char *const inputEventTypeNames[] = { "key", "special", "reshape" };
+
+struct InputEvent {
+	unsigned long long frame;
+	double milliseconds;
+	InputEventType type;
+	int a, b, c;
+};
+
+class InputRecorder {
+public:
+	InputRecorder() : file(NULL), frames(0) {}
+
+	~InputRecorder() { close(); }
+
+	//------------------------------------------------
+	bool open(const char *path) {
+		close();
+		file = fopen(path, "w");
+		if (!file) {
+			return false;
+		}
+		fprintf(file, "# input session: frame milliseconds type a b c\n");
+		frames = 0;
+		start = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	bool isOpen() const { return file != NULL; }
+
+	//------------------------------------------------
+	void record(InputEventType type, int a, int b, int c) {
+		if (!file) {
+			return;
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		fprintf(file, "%llu %.3f %s %d %d %d\n", frames, milliseconds, inputEventTypeNames[type], a, b, c);
+	}
+
+	void frameDrawn() { frames++; }
+
+	//------------------------------------------------
+	void close() {
+		if (!file) {
+			return;
+		}
+		fprintf(file, "end %llu\n", frames);
+		fclose(file);
+		file = NULL;
+	}
+
+private:
+	FILE *file;
+	unsigned long long frames;
+	std::chrono::steady_clock::time_point start;
+};
+
+class InputPlayer {
+public:
+	InputPlayer() : opened(false), next(0), frames(0), endFrame(0) {}
+
+	//------------------------------------------------
+	// Read the whole session. Returns false if the file is missing or a line is malformed.
+	bool open(const char *path) {
+		opened = false;
+		events.clear();
+		frameTimes.clear();
+		hashes.clear();
+		next = 0;
+		frames = 0;
+		endFrame = 0;
+
+		FILE *file = fopen(path, "r");
+		if (!file) {
+			return false;
+		}
+		char line[256];
+		bool ended = false;
+		bool valid = true;
+		while (valid && fgets(line, sizeof(line), file)) {
+			if (line[0] == '#' || line[0] == '\n') {
+				continue;
+			}
+			if (sscanf(line, "end %llu", &endFrame) == 1) {
+				ended = true;
+				break;
+			}
+			InputEvent event;
+			char type[16];
+			valid = sscanf(line, "%llu %lf %15s %d %d %d", &event.frame, &event.milliseconds, type,
+				&event.a, &event.b, &event.c) == 6;
+			valid = valid && parseType(type, event.type);
+			if (valid) {
+				events.push_back(event);
+			}
+		}
+		fclose(file);
+
+		// A session cut short (e.g. the program was killed) ends with its last event.
+		if (!ended && !events.empty()) {
+			endFrame = events.back().frame;
+		}
+		opened = valid;
+		return valid;
+	}
+
+	bool isOpen() const { return opened; }
+
+	//------------------------------------------------
+	bool nextEvent(InputEvent &event) {
+		if (next >= events.size() || events[next].frame > frames) {
+			return false;
+		}
+		event = events[next++];
+		return true;
+	}
+
+	//------------------------------------------------
+	void frameDrawn() {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		frameTimes.push_back(frames == 0 ? 0.0 : std::chrono::duration<double, std::milli>(now - last).count());
+		last = now;
+		frames++;
+	}
+
+	//------------------------------------------------
+	void frameHashed(unsigned long long imageHash) {
+		hashes.push_back(imageHash);
+		last = std::chrono::steady_clock::now();
+	}
+
+	bool finished() const { return opened && frames >= endFrame && next >= events.size(); }
+
+	unsigned long long frame() const { return frames; }
+
+	//------------------------------------------------
+	// The first frame has no previous frame, so its time is left out.
+	void report(std::ostream &out) const {
+		out << "Replayed " << frames << " frames, " << next << " of " << events.size() << " events" << std::endl;
+		if (frameTimes.size() < 2) {
+			return;
+		}
+		std::vector<double> sorted(frameTimes.begin() + 1, frameTimes.end());
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (size_t i = 0; i < sorted.size(); i++) {
+			sum += sorted[i];
+		}
+		out << std::fixed << std::setprecision(2) << "Frame time (ms): mean " << sum / sorted.size()
+			<< ", p50 " << percentile(sorted, 50.0) << ", p90 " << percentile(sorted, 90.0)
+			<< ", p99 " << percentile(sorted, 99.0) << ", max " << sorted.back() << std::endl;
+	}
+
+	//------------------------------------------------
+	bool writeFrames(const char *path) const {
+		FILE *file = fopen(path, "w");
+		if (!file) {
+			return false;
+		}
+		fprintf(file, "frame,milliseconds,hash\n");
+		for (size_t i = 0; i < frameTimes.size(); i++) {
+			if (i < hashes.size()) {
+				fprintf(file, "%u,%.3f,%016llx\n", (unsigned int)i, frameTimes[i], hashes[i]);
+			} else {
+				fprintf(file, "%u,%.3f,\n", (unsigned int)i, frameTimes[i]);
+			}
+		}
+		fclose(file);
+		return true;
+	}
+
+private:
+	static bool parseType(const char *name, InputEventType &type) {
+		for (int t = INPUT_KEY; t <= INPUT_RESHAPE; t++) {
+			if (strcmp(name, inputEventTypeNames[t]) == 0) {
+				type = (InputEventType)t;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Nearest-rank percentile of sorted values.
+	static double percentile(const std::vector<double> &sorted, double p) {
+		size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+		rank = std::min(std::max(rank, (size_t)1), sorted.size());
+		return sorted[rank - 1];
+	}
+
+	bool opened;
+	std::vector<InputEvent> events;
+	size_t next; // the next event to deliver
+	unsigned long long frames, endFrame;
+	std::vector<double> frameTimes;
+	std::vector<unsigned long long> hashes;
+	std::chrono::steady_clock::time_point last;
+};
+
+//------------------------------------------------
+// Reading the pixels waits for the frame to finish. Call it after InputPlayer::frameDrawn(),
+// and pass the hash to frameHashed(), so the wait is left out of the frame times.
+inline unsigned long long framebufferHash() {
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	std::vector<unsigned char> pixels((size_t)viewport[2] * viewport[3] * 4);
+	if (pixels.empty()) {
+		return 0;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_BACK);
+	glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < pixels.size(); i++) {
+		hash ^= pixels[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
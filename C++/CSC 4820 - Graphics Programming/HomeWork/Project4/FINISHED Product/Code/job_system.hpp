@@ -0,0 +1,519 @@
+/* This is a utility program that runs small jobs on a fixed set of worker threads with
+work stealing. Every worker owns a Chase-Lev deque: it pushes and pops its own jobs at the
+bottom, newest first, and a worker that runs out of jobs steals the oldest job from the top
+of another worker's deque. Jobs submitted by other threads (e.g. the main thread) go to a
+shared queue. A thread that waits for jobs runs queued jobs itself until they are done, so
+a job can wait for other jobs without a deadlock. The following classes are provided.
+
+// The number of unfinished jobs of a group. JobSystem::wait() returns when it is zero.
+class JobCounter {
+	int pending() const;
+};
+
+class JobSystem {
+	// Start threadCount worker threads; 0 means one per CPU core, less the calling thread.
+	void start(unsigned int threadCount);
+
+	// Run the jobs that are still queued, then stop the threads. Also called by the destructor.
+	void stop();
+
+	// Number of worker threads. The thread that waits runs jobs as well.
+	unsigned int workerCount() const;
+
+	// Run a job on one of the threads (on the calling thread if there are none). The counter,
+	// if there is one, counts the job until it has run.
+	void submit(std::function<void()> job, JobCounter *counter = NULL);
+
+	// Run jobs until the counter is zero.
+	void wait(JobCounter &counter);
+
+	// Run job(0) ... job(count - 1) and wait for them to finish.
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)> &job);
+
+	// Run job(begin, end) over ranges that cover 0 ... count - 1 and wait for them to finish.
+	// The range is split in halves until the pieces are at most grainSize long; the halves
+	// that are not run at once are left for other threads to steal.
+	void parallelForRange(size_t count, size_t grainSize,
+		const std::function<void(size_t, size_t)> &job);
+};
+
+// Tasks with dependencies. A task is submitted when all the tasks it depends on are done;
+// tasks without a path between them run in parallel. The graph can be run again.
+class TaskGraph {
+	// Add a task; returns its index.
+	unsigned int add(std::function<void()> task);
+
+	// task after cannot start before task before has finished.
+	void precede(unsigned int before, unsigned int after);
+
+	// Run all the tasks and wait for them. Returns false, and runs nothing, if the
+	// dependencies have a cycle.
+	bool run(JobSystem &jobs);
+
+	size_t size() const;
+	void clear();
+};
+
+Typical use:
+
+	JobSystem jobs;
+	jobs.start(0);
+	jobs.parallelFor(scene->mNumMeshes, [&](unsigned int i) {
+		... work on mesh i ...
+	});
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of jobs a worker deque holds before it grows to twice the size.
+const long long JOB_DEQUE_INITIAL_CAPACITY = 256;
+
+class JobCounter {
+public:
+	JobCounter() : count(0) {}
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	int pending() const { return count.load(std::memory_order_acquire); }
+
+private:
+	friend class JobSystem;
+	std::atomic<int> count;
+};
+
+// A submitted job, owned by the deque or queue that holds it until a thread takes it.
+struct Job {
+	std::function<void()> function;
+	JobCounter *counter;
+};
+
+//------------------------------------------------
+// The deque of one worker, after Chase and Lev, "Dynamic Circular Work-Stealing Deque"
+// (2005), with the memory orders of Le et al., "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (2013). Only the owner calls push() and pop(); any thread can call
+// steal(). The arrays replaced by a larger one are kept until the deque is destroyed,
+// because a thief may still be reading them.
+class JobDeque {
+public:
+	JobDeque() : top(0), bottom(0) {
+		arrays.push_back(std::unique_ptr<Array>(new Array(JOB_DEQUE_INITIAL_CAPACITY)));
+		array.store(arrays.back().get(), std::memory_order_relaxed);
+	}
+
+	JobDeque(const JobDeque&) = delete;
+	JobDeque& operator=(const JobDeque&) = delete;
+
+	//------------------------------------------------
+	void push(Job *job) {
+		long long b = bottom.load(std::memory_order_relaxed);
+		long long t = top.load(std::memory_order_acquire);
+		Array *a = array.load(std::memory_order_relaxed);
+		if (b - t > a->capacity - 1) {
+			a = grow(a, t, b);
+		}
+		a->put(b, job);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	//------------------------------------------------
+	// Take the newest job. Returns NULL if the deque is empty, or if a thief took the last job.
+	Job *pop() {
+		long long b = bottom.load(std::memory_order_relaxed) - 1;
+		Array *a = array.load(std::memory_order_relaxed);
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long t = top.load(std::memory_order_relaxed);
+
+		Job *job = NULL;
+		if (t <= b) {
+			job = a->get(b);
+			if (t == b) {
+				// The last job: race the thieves for it.
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					job = NULL;
+				}
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	//------------------------------------------------
+	// Take the oldest job. Returns NULL if the deque is empty or another thread took it first.
+	Job *steal() {
+		long long t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long b = bottom.load(std::memory_order_acquire);
+		if (t >= b) {
+			return NULL;
+		}
+		Job *job = array.load(std::memory_order_acquire)->get(t);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return NULL;
+		}
+		return job;
+	}
+
+private:
+	// A circular array of jobs. The slots are atomic because a thief may read a slot
+	// that the owner is writing; the thief then loses the race for top and drops it.
+	struct Array {
+		explicit Array(long long size) : capacity(size), slots(new std::atomic<Job*>[size]) {}
+
+		Job *get(long long i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+		void put(long long i, Job *job) { slots[i & (capacity - 1)].store(job, std::memory_order_relaxed); }
+
+		long long capacity; // a power of two
+		std::unique_ptr<std::atomic<Job*>[]> slots;
+	};
+
+	//------------------------------------------------
+	Array *grow(Array *a, long long t, long long b) {
+		Array *larger = new Array(2 * a->capacity);
+		for (long long i = t; i < b; i++) {
+			larger->put(i, a->get(i));
+		}
+		arrays.push_back(std::unique_ptr<Array>(larger));
+		array.store(larger, std::memory_order_release);
+		return larger;
+	}
+
+	std::atomic<long long> top;
+	std::atomic<long long> bottom;
+	std::atomic<Array*> array;
+	std::vector<std::unique_ptr<Array> > arrays; // written only by the owner
+};
+
+class JobSystem {
+public:
+	JobSystem() : queuedJobs(0), sleepingWorkers(0), stopping(false) {}
+
+	~JobSystem() { stop(); }
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	//------------------------------------------------
+	void start(unsigned int threadCount) {
+		stop();
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+		}
+		// Always keep one worker, so that submit() returns before the job has run.
+		threadCount = std::max(1u, threadCount);
+
+		stopping.store(false);
+		for (unsigned int i = 0; i < threadCount; i++) {
+			deques.push_back(std::unique_ptr<JobDeque>(new JobDeque()));
+		}
+		for (unsigned int i = 0; i < threadCount; i++) {
+			threads.push_back(std::thread(&JobSystem::run, this, i));
+		}
+	}
+
+	//------------------------------------------------
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping.store(true);
+		}
+		workAvailable.notify_all();
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i].join();
+		}
+		threads.clear();
+		deques.clear();
+	}
+
+	unsigned int workerCount() const { return (unsigned int)threads.size(); }
+
+	//------------------------------------------------
+	void submit(std::function<void()> job, JobCounter *counter = NULL) {
+		if (counter != NULL) {
+			counter->count.fetch_add(1, std::memory_order_relaxed);
+		}
+		Job *queued = new Job;
+		queued->function = std::move(job);
+		queued->counter = counter;
+		if (threads.empty()) {
+			execute(queued);
+			return;
+		}
+
+		queuedJobs.fetch_add(1);
+		WorkerSlot &slot = currentWorker();
+		if (slot.system == this) {
+			deques[slot.index]->push(queued);
+		} else {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			sharedJobs.push_back(queued);
+		}
+
+		// A worker that is going to sleep has counted itself in sleepingWorkers before it
+		// looks at queuedJobs, so either it sees this job or this thread sees it and wakes it.
+		if (sleepingWorkers.load() > 0) {
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+			}
+			workAvailable.notify_one();
+		}
+	}
+
+	//------------------------------------------------
+	void wait(JobCounter &counter) {
+		WorkerSlot &slot = currentWorker();
+		int worker = slot.system == this ? (int)slot.index : -1;
+		while (counter.pending() > 0) {
+			Job *job = findJob(worker);
+			if (job != NULL) {
+				execute(job);
+			} else {
+				// The remaining jobs are running on other threads.
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	//------------------------------------------------
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)> &job) {
+		parallelForRange(count, 1, [&job](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				job((unsigned int)i);
+			}
+		});
+	}
+
+	//------------------------------------------------
+	void parallelForRange(size_t count, size_t grainSize,
+		const std::function<void(size_t, size_t)> &job) {
+		if (count == 0) {
+			return;
+		}
+		grainSize = std::max((size_t)1, grainSize);
+		if (threads.empty() || count <= grainSize) {
+			job(0, count);
+			return;
+		}
+		JobCounter counter;
+		splitRange(0, count, grainSize, job, counter);
+		wait(counter);
+	}
+
+private:
+	// The worker a thread is, if it is one.
+	struct WorkerSlot {
+		JobSystem *system;
+		unsigned int index;
+	};
+
+	static WorkerSlot &currentWorker() {
+		static thread_local WorkerSlot slot = { NULL, 0 };
+		return slot;
+	}
+
+	//------------------------------------------------
+	// Leave the upper halves of the range for other threads and run the first piece here.
+	// A thief that takes an upper half splits it again in the same way.
+	void splitRange(size_t begin, size_t end, size_t grainSize,
+		const std::function<void(size_t, size_t)> &job, JobCounter &counter) {
+		while (end - begin > grainSize) {
+			size_t middle = begin + (end - begin) / 2;
+			submit([this, middle, end, grainSize, &job, &counter]() {
+				splitRange(middle, end, grainSize, job, counter);
+			}, &counter);
+			end = middle;
+		}
+		job(begin, end);
+	}
+
+	//------------------------------------------------
+	// Run a job that has been taken from a deque or the shared queue.
+	void execute(Job *job) {
+		job->function();
+		if (job->counter != NULL) {
+			job->counter->count.fetch_sub(1, std::memory_order_release);
+		}
+		delete job;
+	}
+
+	//------------------------------------------------
+	// Take a job: the newest of this worker's own jobs, else the oldest shared job, else
+	// the oldest job of another worker. worker is -1 on a thread that is not a worker.
+	Job *findJob(int worker) {
+		Job *job = NULL;
+		if (worker >= 0) {
+			job = deques[worker]->pop();
+		}
+		if (job == NULL) {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			if (!sharedJobs.empty()) {
+				job = sharedJobs.front();
+				sharedJobs.pop_front();
+			}
+		}
+		if (job == NULL) {
+			// Start at the next worker, so that the thieves spread over the victims.
+			size_t count = deques.size();
+			for (size_t v = 1; v <= count && job == NULL; v++) {
+				size_t victim = (size_t)(worker + v) % count;
+				if ((int)victim != worker) {
+					job = deques[victim]->steal();
+				}
+			}
+		}
+		if (job != NULL) {
+			queuedJobs.fetch_sub(1);
+		}
+		return job;
+	}
+
+	//------------------------------------------------
+	// Worker thread. Runs jobs until stop() is called and no job is left.
+	void run(unsigned int index) {
+		WorkerSlot &slot = currentWorker();
+		slot.system = this;
+		slot.index = index;
+
+		for (;;) {
+			Job *job = findJob((int)index);
+			if (job != NULL) {
+				execute(job);
+				continue;
+			}
+			if (queuedJobs.load() > 0) {
+				// A job is being pushed, or another thief won it.
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepingWorkers.fetch_add(1);
+			workAvailable.wait(lock, [this]() { return stopping.load() || queuedJobs.load() > 0; });
+			sleepingWorkers.fetch_sub(1);
+			if (stopping.load() && queuedJobs.load() == 0) {
+				break;
+			}
+		}
+
+		slot.system = NULL;
+	}
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<JobDeque> > deques;
+
+	// Jobs submitted by threads that are not workers.
+	std::deque<Job*> sharedJobs;
+	std::mutex sharedMutex;
+
+	// Jobs in the deques and the shared queue, and the workers waiting for one.
+	std::atomic<int> queuedJobs;
+	std::atomic<int> sleepingWorkers;
+	std::mutex sleepMutex;
+	std::condition_variable workAvailable;
+	std::atomic<bool> stopping;
+};
+
+class TaskGraph {
+public:
+	//------------------------------------------------
+	unsigned int add(std::function<void()> task) {
+		nodes.push_back(std::unique_ptr<Node>(new Node()));
+		nodes.back()->task = std::move(task);
+		nodes.back()->dependencyCount = 0;
+		return (unsigned int)(nodes.size() - 1);
+	}
+
+	//------------------------------------------------
+	void precede(unsigned int before, unsigned int after) {
+		nodes[before]->successors.push_back(after);
+		nodes[after]->dependencyCount++;
+	}
+
+	//------------------------------------------------
+	bool run(JobSystem &jobs) {
+		if (hasCycle()) {
+			return false;
+		}
+		for (size_t i = 0; i < nodes.size(); i++) {
+			nodes[i]->remaining.store(nodes[i]->dependencyCount);
+		}
+
+		JobCounter counter;
+		for (unsigned int i = 0; i < nodes.size(); i++) {
+			if (nodes[i]->dependencyCount == 0) {
+				submitTask(jobs, i, counter);
+			}
+		}
+		jobs.wait(counter);
+		return true;
+	}
+
+	size_t size() const { return nodes.size(); }
+
+	void clear() { nodes.clear(); }
+
+private:
+	struct Node {
+		std::function<void()> task;
+		std::vector<unsigned int> successors;
+		int dependencyCount;
+		std::atomic<int> remaining; // unfinished dependencies during run()
+	};
+
+	//------------------------------------------------
+	// The successors are submitted before the task's own job ends, so the counter
+	// cannot reach zero while tasks remain.
+	void submitTask(JobSystem &jobs, unsigned int i, JobCounter &counter) {
+		jobs.submit([this, &jobs, i, &counter]() {
+			Node &node = *nodes[i];
+			node.task();
+			for (size_t s = 0; s < node.successors.size(); s++) {
+				unsigned int successor = node.successors[s];
+				if (nodes[successor]->remaining.fetch_sub(1) == 1) {
+					submitTask(jobs, successor, counter);
+				}
+			}
+		}, &counter);
+	}
+
+	//------------------------------------------------
+	// Kahn's algorithm: the graph has a cycle if not every task can be ordered.
+	bool hasCycle() const {
+		std::vector<int> remaining(nodes.size());
+		std::vector<unsigned int> ready;
+		for (unsigned int i = 0; i < nodes.size(); i++) {
+			remaining[i] = nodes[i]->dependencyCount;
+			if (remaining[i] == 0) {
+				ready.push_back(i);
+			}
+		}
+		size_t ordered = 0;
+		while (!ready.empty()) {
+			unsigned int i = ready.back();
+			ready.pop_back();
+			ordered++;
+			for (size_t s = 0; s < nodes[i]->successors.size(); s++) {
+				if (--remaining[nodes[i]->successors[s]] == 0) {
+					ready.push_back(nodes[i]->successors[s]);
+				}
+			}
+		}
+		return ordered != nodes.size();
+	}
+
+	std::vector<std::unique_ptr<Node> > nodes;
+};
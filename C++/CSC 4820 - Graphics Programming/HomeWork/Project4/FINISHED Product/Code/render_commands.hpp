@@ -0,0 +1,332 @@
+/* This is a utility program that records OpenGL draw calls as compact command packets, so
+that the scene can be traversed and culled on worker threads while only one thread, the
+one that owns the OpenGL context, makes the GL calls. Include it after GL/glew.h and
+job_system.hpp. The following classes are provided.
+
+// A linear buffer of command packets. Recording makes no GL calls, so any thread can
+// record; execute() replays the packets in order on the GL thread.
+class RenderCommandBuffer {
+	void clear(); // keeps the memory for the next frame
+
+	void useProgram(GLuint program);
+	void bindTexture(GLenum unit, GLenum target, GLuint texture); // unit is GL_TEXTURE0 + n
+	void bindVertexArray(GLuint vao);
+	void uniform1i(GLint location, GLint value);
+	void uniform3i(GLint location, GLint x, GLint y, GLint z);
+	void uniformHandle(GLint location, GLuint64 handle); // GL_ARB_bindless_texture
+	// The data is copied into the packet.
+	void bufferSubData(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data);
+	void drawElements(GLenum mode, GLsizei count, GLenum type, size_t offset);
+
+	void execute() const;
+
+	size_t commandCount() const;
+	size_t byteCount() const;
+};
+
+// The command buffers of one frame, one per recording job. Each job records into its own
+// buffer; execute() replays the buffers in order, so the draw order does not depend on
+// which thread ran which job.
+class RenderFrame {
+	void reset(unsigned int bufferCount);
+	unsigned int bufferCount() const;
+	RenderCommandBuffer &buffer(unsigned int i);
+
+	void execute() const;
+
+	size_t commandCount() const;
+	size_t byteCount() const;
+
+	unsigned long long tag; // identifies the state the frame was recorded from
+};
+
+// Two frames: the GL thread replays one while a job records the next one.
+class RenderFramePipeline {
+	// Start recording the next frame, from the state it will be drawn from, as a job that
+	// calls record(frame). Returns at once. Nothing is recorded if a frame with this tag is
+	// already recorded or being replayed. The frame is not the one returned by the last
+	// takeRecorded(), so that one can still be replayed.
+	void beginRecording(JobSystem &jobs, unsigned long long tag, const std::function<void(RenderFrame&)> &record);
+
+	// Wait for the recording (the waiting thread runs jobs meanwhile).
+	void finishRecording(JobSystem &jobs);
+
+	// The last recorded frame if it was recorded with this tag, else the frame returned by
+	// the last call if it has this tag (the state has not changed, so it is replayed again),
+	// else NULL. A frame recorded from other state (e.g. before a key changed the scene)
+	// is stale.
+	RenderFrame *takeRecorded(unsigned long long tag);
+
+	// Record a frame now and return it.
+	RenderFrame *record(JobSystem &jobs, unsigned long long tag, const std::function<void(RenderFrame&)> &record);
+};
+
+Typical use in the display callback:
+
+	RenderFrame *frame = pipeline.takeRecorded(tag);
+	if (frame == NULL)
+		frame = pipeline.record(jobs, tag, recordScene);
+	pipeline.beginRecording(jobs, nextTag, recordNextScene); // while this one is drawn
+	frame->execute();
+	glutSwapBuffers();
+	pipeline.finishRecording(jobs);
+
+The next frame must be recorded from the state it will be drawn from (e.g. the newest state
+of the simulation), not from the state of this frame: a copy of this frame is never needed,
+since this frame is replayed again while its tag stays the same. The recording must be
+finished before the state it reads is changed, so a display callback that starts one also
+waits for it before it returns. A frame whose state was not foreseen (e.g. after a key
+changed the scene) is recorded when it is drawn.
+
+*/
+
+#include <cstring>
+#include <functional>
+#include <vector>
+
+enum RenderCommandType {
+	RENDER_USE_PROGRAM,
+	RENDER_BIND_TEXTURE,
+	RENDER_BIND_VERTEX_ARRAY,
+	RENDER_UNIFORM_1I,
+	RENDER_UNIFORM_3I,
+	RENDER_UNIFORM_HANDLE,
+	RENDER_BUFFER_SUB_DATA,
+	RENDER_DRAW_ELEMENTS
+};
+
+// A packet is a header word (the command type in the low byte, the packet length in
+// words above it) followed by its arguments, one 32-bit word each.
+const unsigned int RENDER_COMMAND_TYPE_MASK = 0xff;
+const unsigned int RENDER_COMMAND_LENGTH_SHIFT = 8;
+
+class RenderCommandBuffer {
+public:
+	RenderCommandBuffer() : commands(0) {}
+
+	void clear() {
+		words.clear();
+		commands = 0;
+	}
+
+	void useProgram(GLuint program) {
+		unsigned int *packet = begin(RENDER_USE_PROGRAM, 1);
+		packet[0] = program;
+	}
+
+	void bindTexture(GLenum unit, GLenum target, GLuint texture) {
+		unsigned int *packet = begin(RENDER_BIND_TEXTURE, 3);
+		packet[0] = unit;
+		packet[1] = target;
+		packet[2] = texture;
+	}
+
+	void bindVertexArray(GLuint vao) {
+		unsigned int *packet = begin(RENDER_BIND_VERTEX_ARRAY, 1);
+		packet[0] = vao;
+	}
+
+	void uniform1i(GLint location, GLint value) {
+		unsigned int *packet = begin(RENDER_UNIFORM_1I, 2);
+		packet[0] = (unsigned int)location;
+		packet[1] = (unsigned int)value;
+	}
+
+	void uniform3i(GLint location, GLint x, GLint y, GLint z) {
+		unsigned int *packet = begin(RENDER_UNIFORM_3I, 4);
+		packet[0] = (unsigned int)location;
+		packet[1] = (unsigned int)x;
+		packet[2] = (unsigned int)y;
+		packet[3] = (unsigned int)z;
+	}
+
+	void uniformHandle(GLint location, GLuint64 handle) {
+		unsigned int *packet = begin(RENDER_UNIFORM_HANDLE, 3);
+		packet[0] = (unsigned int)location;
+		packet[1] = (unsigned int)(handle & 0xffffffffu);
+		packet[2] = (unsigned int)(handle >> 32);
+	}
+
+	//------------------------------------------------
+	void bufferSubData(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data) {
+		size_t dataWords = ((size_t)size + 3) / 4;
+		unsigned int *packet = begin(RENDER_BUFFER_SUB_DATA, 4 + dataWords);
+		packet[0] = target;
+		packet[1] = buffer;
+		packet[2] = (unsigned int)offset;
+		packet[3] = (unsigned int)size;
+		memcpy(&packet[4], data, (size_t)size);
+	}
+
+	void drawElements(GLenum mode, GLsizei count, GLenum type, size_t offset) {
+		unsigned int *packet = begin(RENDER_DRAW_ELEMENTS, 4);
+		packet[0] = mode;
+		packet[1] = (unsigned int)count;
+		packet[2] = type;
+		packet[3] = (unsigned int)offset;
+	}
+
+	//------------------------------------------------
+	void execute() const {
+		size_t i = 0;
+		while (i < words.size()) {
+			unsigned int header = words[i];
+			const unsigned int *packet = &words[i + 1];
+			switch (header & RENDER_COMMAND_TYPE_MASK) {
+			case RENDER_USE_PROGRAM:
+				glUseProgram(packet[0]);
+				break;
+			case RENDER_BIND_TEXTURE:
+				glActiveTexture(packet[0]);
+				glBindTexture(packet[1], packet[2]);
+				break;
+			case RENDER_BIND_VERTEX_ARRAY:
+				glBindVertexArray(packet[0]);
+				break;
+			case RENDER_UNIFORM_1I:
+				glUniform1i((GLint)packet[0], (GLint)packet[1]);
+				break;
+			case RENDER_UNIFORM_3I:
+				glUniform3i((GLint)packet[0], (GLint)packet[1], (GLint)packet[2], (GLint)packet[3]);
+				break;
+			case RENDER_UNIFORM_HANDLE:
+#ifdef GL_ARB_bindless_texture
+				glUniformHandleui64ARB((GLint)packet[0], (GLuint64)packet[1] | ((GLuint64)packet[2] << 32));
+#endif
+				break;
+			case RENDER_BUFFER_SUB_DATA:
+				glBindBuffer(packet[0], packet[1]);
+				glBufferSubData(packet[0], (GLintptr)packet[2], (GLsizeiptr)packet[3], &packet[4]);
+				glBindBuffer(packet[0], 0);
+				break;
+			case RENDER_DRAW_ELEMENTS:
+				glDrawElements(packet[0], (GLsizei)packet[1], packet[2], (const GLvoid*)(size_t)packet[3]);
+				break;
+			}
+			i += 1 + (header >> RENDER_COMMAND_LENGTH_SHIFT);
+		}
+	}
+
+	size_t commandCount() const { return commands; }
+
+	size_t byteCount() const { return words.size() * sizeof(unsigned int); }
+
+private:
+	//------------------------------------------------
+	// Append a packet of the given type with room for its arguments, and return the
+	// arguments. The pointer is only valid until the next packet is appended.
+	unsigned int *begin(RenderCommandType type, size_t argumentWords) {
+		size_t at = words.size();
+		words.resize(at + 1 + argumentWords);
+		words[at] = (unsigned int)type | (unsigned int)(argumentWords << RENDER_COMMAND_LENGTH_SHIFT);
+		commands++;
+		return &words[at + 1];
+	}
+
+	std::vector<unsigned int> words;
+	size_t commands;
+};
+
+class RenderFrame {
+public:
+	RenderFrame() : tag(0), count(0) {}
+
+	//------------------------------------------------
+	void reset(unsigned int bufferCount) {
+		if (buffers.size() < bufferCount) {
+			buffers.resize(bufferCount);
+		}
+		for (size_t i = 0; i < buffers.size(); i++) {
+			buffers[i].clear();
+		}
+		count = bufferCount;
+	}
+
+	unsigned int bufferCount() const { return count; }
+
+	RenderCommandBuffer &buffer(unsigned int i) { return buffers[i]; }
+
+	void execute() const {
+		for (unsigned int i = 0; i < count; i++) {
+			buffers[i].execute();
+		}
+	}
+
+	//------------------------------------------------
+	size_t commandCount() const {
+		size_t sum = 0;
+		for (unsigned int i = 0; i < count; i++) {
+			sum += buffers[i].commandCount();
+		}
+		return sum;
+	}
+
+	//------------------------------------------------
+	size_t byteCount() const {
+		size_t sum = 0;
+		for (unsigned int i = 0; i < count; i++) {
+			sum += buffers[i].byteCount();
+		}
+		return sum;
+	}
+
+	unsigned long long tag;
+
+private:
+	// Kept between frames, so that recording does not allocate once the buffers have grown.
+	std::vector<RenderCommandBuffer> buffers;
+	unsigned int count;
+};
+
+class RenderFramePipeline {
+public:
+	RenderFramePipeline() : recording(-1), recorded(-1), replaying(-1) {}
+
+	//------------------------------------------------
+	void beginRecording(JobSystem &jobs, unsigned long long tag, const std::function<void(RenderFrame&)> &record) {
+		finishRecording(jobs);
+		if ((recorded >= 0 && frames[recorded].tag == tag) || (replaying >= 0 && frames[replaying].tag == tag)) {
+			return;
+		}
+		recording = replaying == 0 ? 1 : 0;
+		if (recorded == recording) {
+			recorded = -1; // stale, and about to be overwritten
+		}
+		RenderFrame *frame = &frames[recording];
+		frame->tag = tag;
+		jobs.submit([frame, record]() { record(*frame); }, &counter);
+	}
+
+	//------------------------------------------------
+	void finishRecording(JobSystem &jobs) {
+		if (recording < 0) {
+			return;
+		}
+		jobs.wait(counter);
+		recorded = recording;
+		recording = -1;
+	}
+
+	//------------------------------------------------
+	RenderFrame *takeRecorded(unsigned long long tag) {
+		if (recorded >= 0 && frames[recorded].tag == tag) {
+			replaying = recorded;
+			recorded = -1;
+		} else if (replaying < 0 || frames[replaying].tag != tag) {
+			return NULL;
+		}
+		return &frames[replaying];
+	}
+
+	//------------------------------------------------
+	RenderFrame *record(JobSystem &jobs, unsigned long long tag, const std::function<void(RenderFrame&)> &record) {
+		beginRecording(jobs, tag, record);
+		finishRecording(jobs);
+		return takeRecorded(tag);
+	}
+
+private:
+	RenderFrame frames[2];
+	JobCounter counter;
+	int recording, recorded, replaying; // indices in frames, or -1
+};
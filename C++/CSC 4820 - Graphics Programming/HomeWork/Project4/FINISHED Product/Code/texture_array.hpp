@@ -0,0 +1,132 @@
+/* This is a utility program that packs texture images into the layers of one GL_TEXTURE_2D_ARRAY,
+so that meshes with different images are drawn without binding a texture in between: the
+array is bound once, and each mesh only tells the shader which layers to sample.
+The following class is provided.
+
+class TextureArrayBuilder {
+	// Add an RGBA image (4 bytes per texel, e.g. from SOIL_load_image(..., SOIL_LOAD_RGBA)).
+	// The pixels are copied. Returns the layer of the image in the array.
+	int addImage(const unsigned char* pixels, int width, int height);
+
+	// Create the texture array with mipmaps and return its ID (0 if no image was added).
+	// The caller owns the texture, e.g. GpuTexture(GL_TEXTURE_2D_ARRAY, id).
+	GLuint build();
+
+	// Size of the layers and number of layers of the last build().
+	int width();
+	int height();
+	int layerCount();
+};
+
+All the layers of a texture array have the same size. The layers are as large as the largest
+image that was added, and smaller images are scaled up with bilinear filtering (a message
+tells which). Images that already have the layer size are copied as they are.
+
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+class TextureArrayBuilder {
+public:
+	TextureArrayBuilder() : layerWidth(0), layerHeight(0) {}
+
+	//------------------------------------------------
+	int addImage(const unsigned char* pixels, int width, int height) {
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign(pixels, pixels + 4 * width * height);
+		images.push_back(image);
+		return (int)images.size() - 1;
+	}
+
+	//------------------------------------------------
+	GLuint build() {
+		if (images.empty()) {
+			return 0;
+		}
+
+		layerWidth = 0;
+		layerHeight = 0;
+		for (unsigned int i = 0; i < images.size(); i++) {
+			layerWidth = max(layerWidth, images[i].width);
+			layerHeight = max(layerHeight, images[i].height);
+		}
+
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerWidth, layerHeight, (GLsizei)images.size(), 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		vector<unsigned char> scaled;
+		for (unsigned int i = 0; i < images.size(); i++) {
+			const Image& image = images[i];
+			const unsigned char* layerPixels = &image.pixels[0];
+			if (image.width != layerWidth || image.height != layerHeight) {
+				cout << "Texture array layer " << i << ": scaling " << image.width << " x " << image.height
+					<< " to " << layerWidth << " x " << layerHeight << endl;
+				scaleImage(image, layerWidth, layerHeight, scaled);
+				layerPixels = &scaled[0];
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, layerWidth, layerHeight, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, layerPixels);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		// Each layer gets its own mipmaps; the layers are never filtered together.
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		return textureID;
+	}
+
+	int width() const { return layerWidth; }
+	int height() const { return layerHeight; }
+	int layerCount() const { return (int)images.size(); }
+
+private:
+	struct Image {
+		int width;
+		int height;
+		vector<unsigned char> pixels;
+	};
+
+	//------------------------------------------------
+	// Bilinear scaling of an RGBA image. Texel centers are matched, as in GL_LINEAR.
+	static void scaleImage(const Image& image, int width, int height, vector<unsigned char>& scaled) {
+		scaled.resize(4 * width * height);
+		for (int y = 0; y < height; y++) {
+			float sourceY = max(0.0f, (y + 0.5f) * image.height / height - 0.5f);
+			int y0 = min((int)sourceY, image.height - 1);
+			int y1 = min(y0 + 1, image.height - 1);
+			float fy = sourceY - y0;
+			for (int x = 0; x < width; x++) {
+				float sourceX = max(0.0f, (x + 0.5f) * image.width / width - 0.5f);
+				int x0 = min((int)sourceX, image.width - 1);
+				int x1 = min(x0 + 1, image.width - 1);
+				float fx = sourceX - x0;
+				for (int c = 0; c < 4; c++) {
+					float top = image.pixels[4 * (y0 * image.width + x0) + c] * (1.0f - fx)
+						+ image.pixels[4 * (y0 * image.width + x1) + c] * fx;
+					float bottom = image.pixels[4 * (y1 * image.width + x0) + c] * (1.0f - fx)
+						+ image.pixels[4 * (y1 * image.width + x1) + c] * fx;
+					scaled[4 * (y * width + x) + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+	}
+
+	vector<Image> images;
+	int layerWidth;
+	int layerHeight;
+};
@@ -0,0 +1,191 @@
+/*
+John Rucker
+Project 4
+
+Texture build step.
+
+Compresses texture images to BC1 (opaque images) or BC3 (images with transparency) with
+all their mipmaps and writes them next to the images as DDS files, e.g. garden.jpg ->
+garden.dds. Rucker_proj4_obj.cc loads the DDS file instead of the image when there is
+one, and uploads the compressed blocks directly.
+
+For each image it reports the size of the RGBA8 texture with mipmaps, the size of the
+compressed texture, the encoding time, and the error of the compressed full-size image
+(root mean square over the color channels, 0-255).
+
+With vt, the images are cut into the 128 x 128 pages of a virtual texture instead and
+written to page files, e.g. garden.jpg -> garden.vt (see virtual_texture.hpp).
+
+Usage: texture_build [bc1|bc3|vt] image...
+With bc1 or bc3, every image gets that format; otherwise it is picked per image.
+Run it again after an image changes.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <GL/glew.h>
+#include "SOIL.h"
+
+#include "gl_resources.hpp"
+#include "texture_quality.hpp"
+#include "texture_compress.hpp"
+#include "virtual_texture.hpp"
+
+using namespace std;
+
+double elapsedMilliseconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//------------------------------------------------------
+// Decode the colors of a BC1 block, or of the color half of a BC3 block.
+void decodeColorBlock(const unsigned char* block, unsigned char texels[48]) {
+	unsigned short color0 = block[0] | (block[1] << 8), color1 = block[2] | (block[3] << 8);
+	float palette[4][3];
+	unpackRgb565(color0, palette[0]);
+	unpackRgb565(color1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		if (color0 > color1) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		} else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+			palette[3][c] = 0.0f;
+		}
+	}
+	for (int i = 0; i < 16; i++) {
+		int index = (block[4 + i / 4] >> (2 * (i % 4))) & 3;
+		for (int c = 0; c < 3; c++) {
+			texels[3 * i + c] = (unsigned char)(palette[index][c] + 0.5f);
+		}
+	}
+}
+
+//------------------------------------------------------
+// Root mean square error of the colors of level 0 against the source image.
+double compressionError(const unsigned char* pixels, const CompressedImage& image) {
+	size_t blockBytes = image.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+	const unsigned char* block = &image.levels[0][0];
+	double sum = 0.0;
+	unsigned char texels[48];
+	for (int blockY = 0; blockY < image.height; blockY += 4) {
+		for (int blockX = 0; blockX < image.width; blockX += 4) {
+			decodeColorBlock(block + blockBytes - 8, texels);
+			for (int i = 0; i < 16; i++) {
+				int x = blockX + i % 4, y = blockY + i / 4;
+				if (x >= image.width || y >= image.height) {
+					continue;
+				}
+				for (int c = 0; c < 3; c++) {
+					double d = (double)texels[3 * i + c] - pixels[4 * (y * image.width + x) + c];
+					sum += d * d;
+				}
+			}
+			block += blockBytes;
+		}
+	}
+	return sqrt(sum / (3.0 * image.width * image.height));
+}
+
+//------------------------------------------------------
+// Write the page files of the images.
+int buildVirtualTextures(int imageCount, char* images[]) {
+	cout << left << setw(20) << "image" << right << setw(14) << "size" << setw(8) << "levels"
+		<< setw(8) << "pages" << setw(12) << "file KB" << setw(10) << "ms" << endl;
+
+	int failures = 0;
+	for (int i = 0; i < imageCount; i++) {
+		int width, height, channels;
+		unsigned char* pixels = SOIL_load_image(images[i], &width, &height, &channels, SOIL_LOAD_RGBA);
+		if (pixels == NULL) {
+			cout << "Couldn't load " << images[i] << endl;
+			failures++;
+			continue;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		string outputName = virtualTextureFileName(images[i]);
+		if (!writeVirtualTexturePages(outputName.c_str(), pixels, width, height)) {
+			cout << "Couldn't write " << outputName << endl;
+			failures++;
+		}
+		double milliseconds = elapsedMilliseconds(start);
+
+		VirtualTextureHeader header = virtualTextureHeader(width, height);
+		long long fileBytes = virtualPageOffset(header, 0, 0, header.levelCount);
+		cout << left << setw(20) << images[i] << right << setw(14) << (to_string(width) + " x " + to_string(height))
+			<< setw(8) << header.levelCount << setw(8) << (fileBytes - (long long)sizeof(header)) / (4LL * VIRTUAL_SLOT_SIZE * VIRTUAL_SLOT_SIZE)
+			<< setw(12) << fileBytes / 1024 << setw(10) << fixed << setprecision(1) << milliseconds << endl;
+		SOIL_free_image_data(pixels);
+	}
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//------------------------------------------------------
+int main(int argc, char* argv[]) {
+	int first = 1;
+	GLenum forcedFormat = 0;
+	if (argc > 1 && string(argv[1]) == "bc1") {
+		forcedFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		first = 2;
+	} else if (argc > 1 && string(argv[1]) == "bc3") {
+		forcedFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		first = 2;
+	} else if (argc > 2 && string(argv[1]) == "vt") {
+		return buildVirtualTextures(argc - 2, argv + 2);
+	}
+	if (first >= argc) {
+		cout << "Usage: texture_build [bc1|bc3|vt] image..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	cout << left << setw(20) << "image" << right << setw(12) << "size" << setw(8) << "format"
+		<< setw(12) << "RGBA8 KB" << setw(12) << "DDS KB" << setw(10) << "ms" << setw(8) << "RMSE" << endl;
+
+	int failures = 0;
+	for (int arg = first; arg < argc; arg++) {
+		int width, height, channels;
+		unsigned char* pixels = SOIL_load_image(argv[arg], &width, &height, &channels, SOIL_LOAD_RGBA);
+		if (pixels == NULL) {
+			cout << "Couldn't load " << argv[arg] << endl;
+			failures++;
+			continue;
+		}
+
+		GLenum format = forcedFormat;
+		if (format == 0) {
+			format = hasTransparency(pixels, width, height) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		CompressedImage image;
+		compressImage(pixels, width, height, format, image);
+		double milliseconds = elapsedMilliseconds(start);
+
+		// The mipmaps add a third to the size of the full image.
+		size_t uncompressedBytes = 0, compressedBytes = 0;
+		for (unsigned int level = 0; level < image.levels.size(); level++) {
+			uncompressedBytes += 4 * (size_t)max(1, width >> level) * max(1, height >> level);
+			compressedBytes += image.levels[level].size();
+		}
+
+		string outputName = compressedFileName(argv[arg]);
+		if (!writeDds(outputName.c_str(), image)) {
+			cout << "Couldn't write " << outputName << endl;
+			failures++;
+		}
+
+		cout << left << setw(20) << argv[arg] << right << setw(12) << (to_string(width) + " x " + to_string(height))
+			<< setw(8) << (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? "BC1" : "BC3")
+			<< setw(12) << uncompressedBytes / 1024 << setw(12) << compressedBytes / 1024
+			<< setw(10) << fixed << setprecision(1) << milliseconds
+			<< setw(8) << setprecision(2) << compressionError(pixels, image) << endl;
+		SOIL_free_image_data(pixels);
+	}
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,390 @@
+/* This is a utility program that compresses texture images to BC1 (DXT1) or BC3 (DXT5) with
+all their mipmaps, stores them in DDS files, and uploads the compressed blocks directly with
+glCompressedTexImage2D(). A BC1 texture takes 1/8 of the memory of RGBA8 and a BC3 texture 1/4,
+and the GPU samples the blocks without decompressing them first.
+The encoder runs on the CPU, so the DDS files are made offline by texture_build.cc, and the
+program only reads them. The following struct and functions are provided.
+
+// A compressed image and its mipmaps. levels[0] is the full image; each level is half the
+// size of the previous one, down to 1 x 1. format is GL_COMPRESSED_RGB_S3TC_DXT1_EXT (BC1)
+// or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT (BC3).
+struct CompressedImage {
+	GLenum format;
+	int width;
+	int height;
+	vector<vector<unsigned char> > levels;
+};
+
+// Build the mipmaps of an RGBA image (4 bytes per texel) with a box filter and compress
+// every level. BC1 drops the alpha channel; use BC3 for images with transparency.
+void compressImage(const unsigned char* pixels, int width, int height, GLenum format, CompressedImage& image);
+
+// True if any texel is not fully opaque, i.e. the image needs BC3 rather than BC1.
+bool hasTransparency(const unsigned char* pixels, int width, int height);
+
+// Write and read DDS files ("DXT1" and "DXT5" only). readDds() returns false if the file
+// does not exist, is not a DXT1/DXT5 file, or is shorter than its header says.
+bool writeDds(const char* filename, const CompressedImage& image);
+bool readDds(const char* filename, CompressedImage& image);
+
+// The DDS file of an image file: garden.jpg -> garden.dds
+string compressedFileName(const string& filename);
+
+// Create a GL_TEXTURE_2D, or a GL_TEXTURE_2D_ARRAY with one layer per image, from the
+// compressed levels. The array needs images of the same size and format; otherwise 0 is
+// returned. The caller owns the texture.
+GLuint uploadCompressedTexture(const CompressedImage& image);
+GLuint uploadCompressedTextureArray(const vector<CompressedImage>& images);
+
+The GPU must support GL_EXT_texture_compression_s3tc (all desktop GPUs do).
+Include texture_quality.hpp first; its downsampler makes the mipmaps.
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct CompressedImage {
+	GLenum format;
+	int width;
+	int height;
+	vector<vector<unsigned char> > levels;
+};
+
+//---------------------------------------------------------
+// Bytes of one level: BC1 stores each 4 x 4 block in 8 bytes, BC3 in 16.
+size_t compressedLevelSize(GLenum format, int width, int height) {
+	size_t blockBytes = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+	return blockBytes * ((width + 3) / 4) * ((height + 3) / 4);
+}
+
+//---------------------------------------------------------
+// RGB565 with rounding, and back with the low bits filled in the way the GPU does.
+unsigned short packRgb565(const float color[3]) {
+	int r = min(31, max(0, (int)(color[0] * 31.0f / 255.0f + 0.5f)));
+	int g = min(63, max(0, (int)(color[1] * 63.0f / 255.0f + 0.5f)));
+	int b = min(31, max(0, (int)(color[2] * 31.0f / 255.0f + 0.5f)));
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+void unpackRgb565(unsigned short packed, float color[3]) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (float)((r << 3) | (r >> 2));
+	color[1] = (float)((g << 2) | (g >> 4));
+	color[2] = (float)((b << 3) | (b >> 2));
+}
+
+//---------------------------------------------------------
+// Compress the colors of a block of 16 RGBA texels into 8 bytes. The two end colors are
+// the extremes of the texels along the main axis of their colors (the first eigenvector
+// of the covariance, found by power iteration), which fits gradients much better than
+// the corners of the bounding box. Each texel then gets the nearest of the 4 palette colors.
+void encodeColorBlock(const unsigned char texels[64], unsigned char* block) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			mean[c] += texels[4 * i + c] / 16.0f;
+		}
+	}
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // rr rg rb gg gb bb
+	for (int i = 0; i < 16; i++) {
+		float d[3] = { texels[4 * i] - mean[0], texels[4 * i + 1] - mean[1], texels[4 * i + 2] - mean[2] };
+		covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+		covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+	}
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2] };
+		float length = max(fabs(next[0]), max(fabs(next[1]), fabs(next[2])));
+		if (length < 1e-6f) {
+			break; // all texels have the same color
+		}
+		for (int c = 0; c < 3; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	int lowest = 0, highest = 0;
+	float lowestProjection = 1e30f, highestProjection = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float projection = texels[4 * i] * axis[0] + texels[4 * i + 1] * axis[1] + texels[4 * i + 2] * axis[2];
+		if (projection < lowestProjection) { lowestProjection = projection; lowest = i; }
+		if (projection > highestProjection) { highestProjection = projection; highest = i; }
+	}
+	float end0[3] = { (float)texels[4 * highest], (float)texels[4 * highest + 1], (float)texels[4 * highest + 2] };
+	float end1[3] = { (float)texels[4 * lowest], (float)texels[4 * lowest + 1], (float)texels[4 * lowest + 2] };
+	unsigned short color0 = packRgb565(end0), color1 = packRgb565(end1);
+
+	// color0 > color1 selects the 4-color mode; equal colors need no indices.
+	unsigned int indices = 0;
+	if (color0 < color1) {
+		swap(color0, color1);
+	}
+	if (color0 != color1) {
+		float palette[4][3];
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestDistance = 1e30f;
+			for (int p = 0; p < 4; p++) {
+				float distance = 0.0f;
+				for (int c = 0; c < 3; c++) {
+					float d = texels[4 * i + c] - palette[p][c];
+					distance += d * d;
+				}
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (unsigned int)best << (2 * i);
+		}
+	}
+
+	block[0] = color0 & 0xff; block[1] = color0 >> 8;
+	block[2] = color1 & 0xff; block[3] = color1 >> 8;
+	for (int b = 0; b < 4; b++) {
+		block[4 + b] = (indices >> (8 * b)) & 0xff;
+	}
+}
+
+//---------------------------------------------------------
+// Compress the alpha of a block of 16 RGBA texels into 8 bytes: the largest and smallest
+// alpha, and a 3-bit index per texel into the 8 values interpolated between them.
+void encodeAlphaBlock(const unsigned char texels[64], unsigned char* block) {
+	int alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; i++) {
+		alpha0 = max(alpha0, (int)texels[4 * i + 3]);
+		alpha1 = min(alpha1, (int)texels[4 * i + 3]);
+	}
+
+	unsigned long long indices = 0;
+	if (alpha0 != alpha1) {
+		int palette[8] = { alpha0, alpha1 };
+		for (int p = 1; p < 7; p++) {
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1 + 3) / 7;
+		}
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			for (int p = 1; p < 8; p++) {
+				if (abs(texels[4 * i + 3] - palette[p]) < abs(texels[4 * i + 3] - palette[best])) {
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (3 * i);
+		}
+	}
+
+	block[0] = (unsigned char)alpha0;
+	block[1] = (unsigned char)alpha1;
+	for (int b = 0; b < 6; b++) {
+		block[2 + b] = (indices >> (8 * b)) & 0xff;
+	}
+}
+
+//---------------------------------------------------------
+// Compress one level. Blocks at the right and bottom edges repeat the edge texels.
+void compressLevel(const unsigned char* pixels, int width, int height, GLenum format, vector<unsigned char>& level) {
+	size_t blockBytes = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+	level.resize(compressedLevelSize(format, width, height));
+	unsigned char* block = &level[0];
+	unsigned char texels[64];
+	for (int blockY = 0; blockY < height; blockY += 4) {
+		for (int blockX = 0; blockX < width; blockX += 4) {
+			for (int i = 0; i < 16; i++) {
+				int x = min(blockX + i % 4, width - 1);
+				int y = min(blockY + i / 4, height - 1);
+				memcpy(&texels[4 * i], &pixels[4 * (y * width + x)], 4);
+			}
+			if (blockBytes == 16) {
+				encodeAlphaBlock(texels, block);
+				encodeColorBlock(texels, block + 8);
+			} else {
+				encodeColorBlock(texels, block);
+			}
+			block += blockBytes;
+		}
+	}
+}
+
+//---------------------------------------------------------
+// Half the size with the box filter of texture_quality.hpp.
+void downsampleImage(const vector<unsigned char>& source, int width, int height, vector<unsigned char>& half) {
+	half.resize(4 * max(1, width / 2) * max(1, height / 2));
+	downsampleRgba8(&source[0], width, height, &half[0]);
+}
+
+//---------------------------------------------------------
+void compressImage(const unsigned char* pixels, int width, int height, GLenum format, CompressedImage& image) {
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.levels.clear();
+
+	vector<unsigned char> level(pixels, pixels + 4 * width * height);
+	vector<unsigned char> half;
+	while (true) {
+		image.levels.push_back(vector<unsigned char>());
+		compressLevel(&level[0], width, height, format, image.levels.back());
+		if (width == 1 && height == 1) {
+			break;
+		}
+		downsampleImage(level, width, height, half);
+		level.swap(half);
+		width = max(1, width / 2);
+		height = max(1, height / 2);
+	}
+}
+
+//---------------------------------------------------------
+bool hasTransparency(const unsigned char* pixels, int width, int height) {
+	for (int i = 0; i < width * height; i++) {
+		if (pixels[4 * i + 3] != 255) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+// The parts of the 128-byte DDS header that are used: the magic number, the header, and
+// the pixel format with its FourCC code.
+const unsigned int DDS_MAGIC = 0x20534444; // "DDS "
+const unsigned int DDS_FOURCC_DXT1 = 0x31545844; // "DXT1"
+const unsigned int DDS_FOURCC_DXT5 = 0x35545844; // "DXT5"
+const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+
+bool writeDds(const char* filename, const CompressedImage& image) {
+	unsigned int header[32];
+	memset(header, 0, sizeof(header));
+	header[0] = DDS_MAGIC;
+	header[1] = 124; // header size
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | DDSD_MIPMAPCOUNT | 0x80000; // caps, height, width, pixel format, mipmaps, linear size
+	header[3] = image.height;
+	header[4] = image.width;
+	header[5] = (unsigned int)image.levels[0].size();
+	header[7] = (unsigned int)image.levels.size();
+	header[19] = 32; // pixel format size
+	header[20] = 0x4; // DDPF_FOURCC
+	header[21] = image.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? DDS_FOURCC_DXT1 : DDS_FOURCC_DXT5;
+	header[27] = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+
+	FILE* file = fopen(filename, "wb");
+	if (!file) {
+		return false;
+	}
+	bool written = fwrite(header, sizeof(header), 1, file) == 1;
+	for (unsigned int level = 0; level < image.levels.size() && written; level++) {
+		written = fwrite(&image.levels[level][0], image.levels[level].size(), 1, file) == 1;
+	}
+	fclose(file);
+	return written;
+}
+
+//---------------------------------------------------------
+bool readDds(const char* filename, CompressedImage& image) {
+	FILE* file = fopen(filename, "rb");
+	if (!file) {
+		return false;
+	}
+	unsigned int header[32];
+	bool valid = fread(header, sizeof(header), 1, file) == 1 && header[0] == DDS_MAGIC && header[1] == 124
+		&& (header[21] == DDS_FOURCC_DXT1 || header[21] == DDS_FOURCC_DXT5);
+	if (valid) {
+		image.format = header[21] == DDS_FOURCC_DXT1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		image.height = header[3];
+		image.width = header[4];
+		unsigned int levelCount = (header[2] & DDSD_MIPMAPCOUNT) && header[7] > 0 ? header[7] : 1;
+		image.levels.assign(levelCount, vector<unsigned char>());
+
+		int width = image.width, height = image.height;
+		for (unsigned int level = 0; level < levelCount && valid; level++) {
+			image.levels[level].resize(compressedLevelSize(image.format, width, height));
+			valid = fread(&image.levels[level][0], image.levels[level].size(), 1, file) == 1;
+			width = max(1, width / 2);
+			height = max(1, height / 2);
+		}
+	}
+	fclose(file);
+	return valid;
+}
+
+//---------------------------------------------------------
+string compressedFileName(const string& filename) {
+	size_t dot = filename.find_last_of('.');
+	size_t slash = filename.find_last_of("/\\");
+	if (dot == string::npos || (slash != string::npos && dot < slash)) {
+		return filename + ".dds";
+	}
+	return filename.substr(0, dot) + ".dds";
+}
+
+//---------------------------------------------------------
+GLuint uploadCompressedTexture(const CompressedImage& image) {
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	int width = image.width, height = image.height;
+	for (unsigned int level = 0; level < image.levels.size(); level++) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format, width, height, 0,
+			(GLsizei)image.levels[level].size(), &image.levels[level][0]);
+		width = max(1, width / 2);
+		height = max(1, height / 2);
+	}
+	// A file without the whole mipmap chain still samples as complete.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return textureID;
+}
+
+//---------------------------------------------------------
+GLuint uploadCompressedTextureArray(const vector<CompressedImage>& images) {
+	if (images.empty()) {
+		return 0;
+	}
+	const CompressedImage& first = images[0];
+	for (unsigned int i = 1; i < images.size(); i++) {
+		if (images[i].format != first.format || images[i].width != first.width
+			|| images[i].height != first.height || images[i].levels.size() != first.levels.size()) {
+			return 0;
+		}
+	}
+
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	int width = first.width, height = first.height;
+	for (unsigned int level = 0; level < first.levels.size(); level++) {
+		GLsizei layerSize = (GLsizei)first.levels[level].size();
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.format, width, height, (GLsizei)images.size(), 0,
+			layerSize * (GLsizei)images.size(), NULL);
+		for (unsigned int layer = 0; layer < images.size(); layer++) {
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1,
+				first.format, layerSize, &images[layer].levels[level][0]);
+		}
+		width = max(1, width / 2);
+		height = max(1, height / 2);
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)first.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return textureID;
+}
@@ -0,0 +1,127 @@
+/* This is a utility program for the filtering quality of textures: mipmapped trilinear and
+anisotropic filtering for sampler objects and textures, and a CPU mipmap downsampler that uses
+SSE2 when the compiler targets it.
+Without mipmaps (GL_LINEAR as the minification filter), a texture that is drawn smaller than
+its size skips texels: it shimmers, and neighbouring pixels read texels far apart, which
+thrashes the texture cache. Mipmaps fix both; anisotropic filtering keeps textures seen at a
+grazing angle sharp. The following enum and functions are provided.
+
+enum TextureFiltering {
+	TEXTURE_FILTER_BILINEAR,    // GL_LINEAR, the mipmaps are not used
+	TEXTURE_FILTER_TRILINEAR,   // GL_LINEAR_MIPMAP_LINEAR
+	TEXTURE_FILTER_ANISOTROPIC  // trilinear with the largest anisotropy the GPU supports (at most 16)
+};
+
+// The largest anisotropy of GL_EXT/ARB_texture_filter_anisotropic, or 1 without it.
+float maxTextureAnisotropy();
+
+// Set the filters of a sampler object, or of a texture that is sampled without one.
+// The texture must have mipmaps for the trilinear and anisotropic modes.
+void setSamplerFiltering(GLuint samplerID, TextureFiltering filtering);
+void setTextureFiltering(GLenum target, GLuint textureID, TextureFiltering filtering);
+
+// Half the size of an RGBA8 image with a 2 x 2 box filter (rounded); an odd size repeats the
+// last row or column. half must hold max(1, width / 2) * max(1, height / 2) texels.
+void downsampleRgba8(const unsigned char* pixels, int width, int height, unsigned char* half);
+
+*/
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_QUALITY_SSE2 1
+#endif
+
+using namespace std;
+
+enum TextureFiltering {
+	TEXTURE_FILTER_BILINEAR,
+	TEXTURE_FILTER_TRILINEAR,
+	TEXTURE_FILTER_ANISOTROPIC,
+	TEXTURE_FILTER_COUNT
+};
+
+const char* textureFilteringNames[] = { "bilinear", "trilinear", "anisotropic" };
+
+//---------------------------------------------------------
+float maxTextureAnisotropy() {
+	if (!GLEW_EXT_texture_filter_anisotropic && !GLEW_ARB_texture_filter_anisotropic) {
+		return 1.0f;
+	}
+	GLfloat anisotropy = 1.0f;
+	glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+	return min(anisotropy, 16.0f);
+}
+
+//---------------------------------------------------------
+void setSamplerFiltering(GLuint samplerID, TextureFiltering filtering) {
+	glSamplerParameteri(samplerID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplerID, GL_TEXTURE_MIN_FILTER,
+		filtering == TEXTURE_FILTER_BILINEAR ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+	if (maxTextureAnisotropy() > 1.0f) {
+		glSamplerParameterf(samplerID, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+			filtering == TEXTURE_FILTER_ANISOTROPIC ? maxTextureAnisotropy() : 1.0f);
+	}
+}
+
+//---------------------------------------------------------
+void setTextureFiltering(GLenum target, GLuint textureID, TextureFiltering filtering) {
+	if (textureID == 0) {
+		return;
+	}
+	glBindTexture(target, textureID);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER,
+		filtering == TEXTURE_FILTER_BILINEAR ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+	if (maxTextureAnisotropy() > 1.0f) {
+		glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+			filtering == TEXTURE_FILTER_ANISOTROPIC ? maxTextureAnisotropy() : 1.0f);
+	}
+	glBindTexture(target, 0);
+}
+
+//---------------------------------------------------------
+void downsampleRgba8(const unsigned char* pixels, int width, int height, unsigned char* half) {
+	int halfWidth = max(1, width / 2), halfHeight = max(1, height / 2);
+	for (int y = 0; y < halfHeight; y++) {
+		const unsigned char* row0 = pixels + 4 * width * min(2 * y, height - 1);
+		const unsigned char* row1 = pixels + 4 * width * min(2 * y + 1, height - 1);
+		unsigned char* output = half + 4 * halfWidth * y;
+		int x = 0;
+
+#ifdef TEXTURE_QUALITY_SSE2
+		// 4 output texels from 8 texels of each row. The sums are 16 bits wide, so the
+		// result is rounded exactly like the scalar loop below.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for (; x + 4 <= halfWidth && 2 * x + 8 <= width; x += 4) {
+			__m128i top0 = _mm_loadu_si128((const __m128i*)(row0 + 8 * x));
+			__m128i top1 = _mm_loadu_si128((const __m128i*)(row0 + 8 * x + 16));
+			__m128i bottom0 = _mm_loadu_si128((const __m128i*)(row1 + 8 * x));
+			__m128i bottom1 = _mm_loadu_si128((const __m128i*)(row1 + 8 * x + 16));
+
+			// Vertical sums of texels 0-1, 2-3, 4-5, and 6-7 (two texels of 4 channels each).
+			__m128i sum01 = _mm_add_epi16(_mm_unpacklo_epi8(top0, zero), _mm_unpacklo_epi8(bottom0, zero));
+			__m128i sum23 = _mm_add_epi16(_mm_unpackhi_epi8(top0, zero), _mm_unpackhi_epi8(bottom0, zero));
+			__m128i sum45 = _mm_add_epi16(_mm_unpacklo_epi8(top1, zero), _mm_unpacklo_epi8(bottom1, zero));
+			__m128i sum67 = _mm_add_epi16(_mm_unpackhi_epi8(top1, zero), _mm_unpackhi_epi8(bottom1, zero));
+
+			// Horizontal sums: texel 0 + 1 and 2 + 3, then 4 + 5 and 6 + 7.
+			__m128i first = _mm_add_epi16(_mm_unpacklo_epi64(sum01, sum23), _mm_unpackhi_epi64(sum01, sum23));
+			__m128i second = _mm_add_epi16(_mm_unpacklo_epi64(sum45, sum67), _mm_unpackhi_epi64(sum45, sum67));
+			first = _mm_srli_epi16(_mm_add_epi16(first, two), 2);
+			second = _mm_srli_epi16(_mm_add_epi16(second, two), 2);
+			_mm_storeu_si128((__m128i*)(output + 4 * x), _mm_packus_epi16(first, second));
+		}
+#endif
+
+		for (; x < halfWidth; x++) {
+			int x0 = min(2 * x, width - 1), x1 = min(2 * x + 1, width - 1);
+			for (int c = 0; c < 4; c++) {
+				int sum = row0[4 * x0 + c] + row0[4 * x1 + c] + row1[4 * x0 + c] + row1[4 * x1 + c];
+				output[4 * x + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,643 @@
+/* This is a utility program for virtual texturing: drawing a texture that is far larger than
+the GPU memory it may use. The image and its mipmaps are cut into pages of 128 x 128 texels
+and stored in a page file. Only the pages that are visible are loaded, into a fixed-size page
+cache texture, so the GPU memory stays the same however large the image is.
+The following functions and class are provided.
+
+// Cut an RGBA image (4 bytes per texel) and its mipmaps into pages and write them to a page
+// file. Each page has a 1-texel border from its neighbours (the image repeats), so bilinear
+// filtering works across page edges. texture_build makes the page files offline.
+bool writeVirtualTexturePages(const char* filename, const unsigned char* pixels, int width, int height);
+
+// The page file of an image file: garden.jpg -> garden.vt
+string virtualTextureFileName(const string& filename);
+
+class VirtualTexture {
+	// Open a page file, create the page cache (cacheSlots x cacheSlots pages) and the
+	// indirection texture, and start the loader thread. The coarsest page is loaded at once
+	// and never evicted, so every part of the texture can be drawn from the first frame.
+	bool open(const char* filename, int cacheSlots);
+	void close(); // also called by the destructor
+	bool isOpen();
+
+	// Feedback pass: draw the meshes with the feedback shader (VT_FEEDBACK) between these
+	// two calls. The pass renders at 1/8 of the window size; its pixels are read back through
+	// a pixel buffer and processed one frame later, so the CPU never waits for the GPU.
+	void beginFeedback(int windowWidth, int windowHeight);
+	void endFeedback();
+
+	// Upload at most maxUploads pages that the loader thread has read, evicting the least
+	// recently used pages, and update the indirection texture. Call once per frame.
+	void update(int maxUploads);
+
+	// Bind the page cache and the indirection texture to two texture units, and set the
+	// uniforms of a program that samples the virtual texture.
+	void bind(GLuint cacheUnit, GLuint indirectionUnit);
+	void setUniforms(GLuint programID, bool feedback);
+
+	void printStatistics();
+};
+
+The fragment shader finds the page of a texel in the indirection texture, which has one texel
+per page and one mipmap level per page level. Each texel holds the cache slot of the page and
+the level it came from: if the page is not loaded yet, the entry points to the nearest coarser
+page that is, so the texture gets sharper as the pages arrive instead of showing holes.
+
+The feedback pass writes the page and level each pixel needs as RGBA8 (x, y, level, 255),
+so level 0 can have at most 256 x 256 pages (32768 x 32768 texels).
+
+Include gl_resources.hpp and texture_quality.hpp first.
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+using namespace std;
+
+const int VIRTUAL_PAGE_SIZE = 128;
+const int VIRTUAL_PAGE_BORDER = 1;
+const int VIRTUAL_SLOT_SIZE = VIRTUAL_PAGE_SIZE + 2 * VIRTUAL_PAGE_BORDER;
+const int VIRTUAL_FEEDBACK_SCALE = 8;
+
+// The start of a page file. All the pages follow, level 0 first, row by row.
+struct VirtualTextureHeader {
+	char magic[4]; // "VTEX"
+	int version;
+	int width; // texels of level 0
+	int height;
+	int pagesX; // pages of level 0, a power of two; level n has max(1, pagesX >> n)
+	int pagesY;
+	int levelCount;
+};
+
+//---------------------------------------------------------
+int nextPowerOfTwo(int value) {
+	int power = 1;
+	while (power < value) {
+		power *= 2;
+	}
+	return power;
+}
+
+//---------------------------------------------------------
+// The header of an image of the given size. The page grid is padded to powers of two so
+// that each level has half the pages of the previous one, like the mipmaps of the
+// indirection texture. The padding pages are never sampled.
+VirtualTextureHeader virtualTextureHeader(int width, int height) {
+	VirtualTextureHeader header;
+	memcpy(header.magic, "VTEX", 4);
+	header.version = 1;
+	header.width = width;
+	header.height = height;
+	header.pagesX = nextPowerOfTwo((width + VIRTUAL_PAGE_SIZE - 1) / VIRTUAL_PAGE_SIZE);
+	header.pagesY = nextPowerOfTwo((height + VIRTUAL_PAGE_SIZE - 1) / VIRTUAL_PAGE_SIZE);
+	header.levelCount = 1;
+	while ((header.pagesX >> (header.levelCount - 1)) > 1 || (header.pagesY >> (header.levelCount - 1)) > 1) {
+		header.levelCount++;
+	}
+	return header;
+}
+
+int virtualPagesX(const VirtualTextureHeader& header, int level) { return max(1, header.pagesX >> level); }
+int virtualPagesY(const VirtualTextureHeader& header, int level) { return max(1, header.pagesY >> level); }
+
+//---------------------------------------------------------
+// Position of a page in the page file. A page file of 256 x 256 pages is about 4.4 GB, 
+// past what a long can hold on Windows, so the offsets are 64-bit. 
+long long virtualPageOffset(const VirtualTextureHeader& header, int x, int y, int level) {
+	long long pages = 0;
+	for (int l = 0; l < level; l++) {
+		pages += (long long)virtualPagesX(header, l) * virtualPagesY(header, l);
+	}
+	pages += (long long)y * virtualPagesX(header, level) + x;
+	return (long long)sizeof(VirtualTextureHeader) + pages * 4LL * VIRTUAL_SLOT_SIZE * VIRTUAL_SLOT_SIZE;
+}
+
+//---------------------------------------------------------
+// fseek() with a 64-bit offset. Fails if the offset does not fit the off_t of the system. 
+bool seekVirtualPage(FILE* file, long long offset) {
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	if ((long long)(off_t)offset != offset) {
+		return false;
+	}
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+//---------------------------------------------------------
+bool writeVirtualTexturePages(const char* filename, const unsigned char* pixels, int width, int height) {
+	FILE* file = fopen(filename, "wb");
+	if (!file) {
+		return false;
+	}
+	VirtualTextureHeader header = virtualTextureHeader(width, height);
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	vector<unsigned char> level(pixels, pixels + 4 * width * height);
+	vector<unsigned char> half;
+	vector<unsigned char> page(4 * VIRTUAL_SLOT_SIZE * VIRTUAL_SLOT_SIZE);
+	int levelWidth = width, levelHeight = height;
+	for (int l = 0; l < header.levelCount && written; l++) {
+		for (int pageY = 0; pageY < virtualPagesY(header, l); pageY++) {
+			for (int pageX = 0; pageX < virtualPagesX(header, l) && written; pageX++) {
+				// The texels of the page and its border; the image repeats.
+				for (int y = 0; y < VIRTUAL_SLOT_SIZE; y++) {
+					int sourceY = pageY * VIRTUAL_PAGE_SIZE + y - VIRTUAL_PAGE_BORDER;
+					sourceY = ((sourceY % levelHeight) + levelHeight) % levelHeight;
+					for (int x = 0; x < VIRTUAL_SLOT_SIZE; x++) {
+						int sourceX = pageX * VIRTUAL_PAGE_SIZE + x - VIRTUAL_PAGE_BORDER;
+						sourceX = ((sourceX % levelWidth) + levelWidth) % levelWidth;
+						memcpy(&page[4 * (y * VIRTUAL_SLOT_SIZE + x)], &level[4 * (sourceY * levelWidth + sourceX)], 4);
+					}
+				}
+				written = fwrite(&page[0], page.size(), 1, file) == 1;
+			}
+		}
+
+		half.resize(4 * max(1, levelWidth / 2) * max(1, levelHeight / 2));
+		downsampleRgba8(&level[0], levelWidth, levelHeight, &half[0]);
+		level.swap(half);
+		levelWidth = max(1, levelWidth / 2);
+		levelHeight = max(1, levelHeight / 2);
+	}
+	fclose(file);
+	return written;
+}
+
+//---------------------------------------------------------
+string virtualTextureFileName(const string& filename) {
+	size_t dot = filename.find_last_of('.');
+	size_t slash = filename.find_last_of("/\\");
+	if (dot == string::npos || (slash != string::npos && dot < slash)) {
+		return filename + ".vt";
+	}
+	return filename.substr(0, dot) + ".vt";
+}
+
+//---------------------------------------------------------
+class VirtualTexture {
+public:
+	VirtualTexture() : file(NULL), cacheSlots(0), running(false), frame(0), feedbackWidth(0), feedbackHeight(0),
+		feedbackFrames(0), uploadCount(0), evictionCount(0) {}
+
+	~VirtualTexture() { close(); }
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	//------------------------------------------------
+	bool open(const char* filename, int slotsPerSide) {
+		close();
+
+		file = fopen(filename, "rb");
+		if (!file) {
+			return false;
+		}
+		if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "VTEX", 4) != 0 || header.version != 1
+			|| header.pagesX > 256 || header.pagesY > 256) {
+			cout << filename << " is not a page file this program can use" << endl;
+			fclose(file);
+			file = NULL;
+			return false;
+		}
+		fileName = filename;
+
+		// The page cache. It is never mipmapped: the pages of each level are separate pages.
+		cacheSlots = slotsPerSide;
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSlots * VIRTUAL_SLOT_SIZE, cacheSlots * VIRTUAL_SLOT_SIZE, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		cacheTexture = GpuTexture(GL_TEXTURE_2D, textureID);
+
+		// The indirection texture: one texel per page, one mipmap level per page level.
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		indirection.assign(header.levelCount, vector<unsigned char>());
+		for (int l = 0; l < header.levelCount; l++) {
+			indirection[l].assign(4 * virtualPagesX(header, l) * virtualPagesY(header, l), 0);
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, virtualPagesX(header, l), virtualPagesY(header, l), 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levelCount - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		indirectionTexture = GpuTexture(GL_TEXTURE_2D, textureID);
+		dirtyLevels.assign(header.levelCount, true);
+
+		Slot freeSlot = { NO_PAGE, 0, false };
+		slots.assign(cacheSlots * cacheSlots, freeSlot);
+
+		// The coarsest page is the fallback of every other page.
+		vector<unsigned char> texels;
+		unsigned int top = pageKey(0, 0, header.levelCount - 1);
+		if (!readPage(top, texels)) {
+			cout << "Couldn't read the pages of " << filename << endl;
+			close();
+			return false;
+		}
+		placePage(top, texels);
+		slots[residentPages[top]].locked = true;
+		uploadIndirection();
+
+		running = true;
+		loader = thread(&VirtualTexture::loaderLoop, this);
+		return true;
+	}
+
+	//------------------------------------------------
+	void close() {
+		if (loader.joinable()) {
+			{
+				lock_guard<mutex> lock(loaderMutex);
+				running = false;
+			}
+			loaderWake.notify_all();
+			loader.join();
+		}
+		if (file) {
+			fclose(file);
+			file = NULL;
+		}
+		cacheTexture.release();
+		indirectionTexture.release();
+		feedbackFramebuffer.release();
+		feedbackColor.release();
+		feedbackDepth.release();
+		feedbackBuffers[0].release();
+		feedbackBuffers[1].release();
+		feedbackWidth = feedbackHeight = 0;
+		feedbackFrames = 0;
+		slots.clear();
+		residentPages.clear();
+		requestedPages.clear();
+		loadQueue.clear();
+		loadedPages.clear();
+		indirection.clear();
+	}
+
+	bool isOpen() const { return file != NULL; }
+
+	//------------------------------------------------
+	void beginFeedback(int windowWidth, int windowHeight) {
+		int width = max(1, windowWidth / VIRTUAL_FEEDBACK_SCALE);
+		int height = max(1, windowHeight / VIRTUAL_FEEDBACK_SCALE);
+		if (width != feedbackWidth || height != feedbackHeight) {
+			createFeedbackTarget(width, height);
+		}
+
+		glGetIntegerv(GL_VIEWPORT, savedViewport);
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, savedClearColor);
+		glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer.id());
+		glViewport(0, 0, feedbackWidth, feedbackHeight);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f); // alpha 0: no page
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	//------------------------------------------------
+	void endFeedback() {
+		// Start reading this frame's pixels into one buffer, and process the other buffer,
+		// which the GPU filled during the previous frame.
+		int current = feedbackFrames % 2;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[current].id());
+		glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		if (feedbackFrames > 0) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[1 - current].id());
+			const unsigned char* texels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+				4 * feedbackWidth * feedbackHeight, GL_MAP_READ_BIT);
+			if (texels) {
+				processFeedback(texels, feedbackWidth * feedbackHeight);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		feedbackFrames++;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+		glClearColor(savedClearColor[0], savedClearColor[1], savedClearColor[2], savedClearColor[3]);
+	}
+
+	//------------------------------------------------
+	void update(int maxUploads) {
+		vector<LoadedPage> arrived;
+		{
+			lock_guard<mutex> lock(loaderMutex);
+			while (!loadedPages.empty() && (int)arrived.size() < maxUploads) {
+				arrived.push_back(LoadedPage());
+				arrived.back().key = loadedPages.front().key;
+				arrived.back().texels.swap(loadedPages.front().texels);
+				loadedPages.pop_front();
+			}
+		}
+
+		for (unsigned int i = 0; i < arrived.size(); i++) {
+			requestedPages.erase(arrived[i].key);
+			if (!arrived[i].texels.empty() && residentPages.find(arrived[i].key) == residentPages.end()) {
+				placePage(arrived[i].key, arrived[i].texels);
+			}
+		}
+		uploadIndirection();
+	}
+
+	//------------------------------------------------
+	void bind(GLuint cacheUnit, GLuint indirectionUnit) {
+		glActiveTexture(GL_TEXTURE0 + cacheUnit);
+		glBindSampler(cacheUnit, 0);
+		glBindTexture(GL_TEXTURE_2D, cacheTexture.id());
+		glActiveTexture(GL_TEXTURE0 + indirectionUnit);
+		glBindSampler(indirectionUnit, 0);
+		glBindTexture(GL_TEXTURE_2D, indirectionTexture.id());
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	//------------------------------------------------
+	// The feedback pass sees 1/8 of the pixels, so its texture coordinates change 8 times
+	// faster from pixel to pixel; the level bias makes it ask for the level the frame uses.
+	void setUniforms(GLuint programID, bool feedback) {
+		glUniform2f(glGetUniformLocation(programID, "vtImageSize"), (float)header.width, (float)header.height);
+		glUniform2f(glGetUniformLocation(programID, "vtPageGrid"), (float)header.pagesX, (float)header.pagesY);
+		glUniform1f(glGetUniformLocation(programID, "vtMaxLevel"), (float)(header.levelCount - 1));
+		glUniform1f(glGetUniformLocation(programID, "vtLevelBias"), feedback ? -log2((float)VIRTUAL_FEEDBACK_SCALE) : 0.0f);
+	}
+
+	//------------------------------------------------
+	void printStatistics() const {
+		cout << fileName << ": " << header.width << " x " << header.height << " texels, "
+			<< header.levelCount << " levels; " << residentPages.size() << " of " << slots.size()
+			<< " cache pages used (" << (cacheTexture.bytes() + indirectionTexture.bytes()) / 1024 << " KB), "
+			<< requestedPages.size() << " requested, " << uploadCount << " uploaded, "
+			<< evictionCount << " evicted" << endl;
+	}
+
+private:
+	static const unsigned int NO_PAGE = 0xffffffff;
+
+	struct Slot {
+		unsigned int page; // key of the page in the slot, or NO_PAGE
+		unsigned int lastUsed; // last frame whose feedback needed the page
+		bool locked; // the coarsest page is never evicted
+	};
+
+	struct LoadedPage {
+		unsigned int key;
+		vector<unsigned char> texels; // empty if the page could not be read
+	};
+
+	static unsigned int pageKey(int x, int y, int level) { return ((unsigned int)level << 16) | (y << 8) | x; }
+	static int pageX(unsigned int key) { return key & 0xff; }
+	static int pageY(unsigned int key) { return (key >> 8) & 0xff; }
+	static int pageLevel(unsigned int key) { return key >> 16; }
+
+	//------------------------------------------------
+	// Called on the loader thread, and on the main thread before the loader starts.
+	bool readPage(unsigned int key, vector<unsigned char>& texels) {
+		texels.resize(4 * VIRTUAL_SLOT_SIZE * VIRTUAL_SLOT_SIZE);
+		return seekVirtualPage(file, virtualPageOffset(header, pageX(key), pageY(key), pageLevel(key)))
+			&& fread(&texels[0], texels.size(), 1, file) == 1;
+	}
+
+	//------------------------------------------------
+	void loaderLoop() {
+		unique_lock<mutex> lock(loaderMutex);
+		while (running) {
+			if (loadQueue.empty()) {
+				loaderWake.wait(lock);
+				continue;
+			}
+			LoadedPage page;
+			page.key = loadQueue.front();
+			loadQueue.pop_front();
+
+			lock.unlock();
+			if (!readPage(page.key, page.texels)) {
+				page.texels.clear();
+			}
+			lock.lock();
+			loadedPages.push_back(LoadedPage());
+			loadedPages.back().key = page.key;
+			loadedPages.back().texels.swap(page.texels);
+		}
+	}
+
+	//------------------------------------------------
+	// Mark the pages the frame needs as used, and ask the loader for the missing ones, the
+	// coarsest first. Requests that the loader has not started are replaced, so it never
+	// reads pages that went out of view.
+	void processFeedback(const unsigned char* texels, int count) {
+		frame++;
+		set<unsigned int> needed;
+		for (int i = 0; i < count; i++) {
+			const unsigned char* texel = texels + 4 * i;
+			if (texel[3] == 0 || texel[2] >= header.levelCount || texel[0] >= virtualPagesX(header, texel[2])
+				|| texel[1] >= virtualPagesY(header, texel[2])) {
+				continue;
+			}
+			needed.insert(pageKey(texel[0], texel[1], texel[2]));
+		}
+
+		lock_guard<mutex> lock(loaderMutex);
+		for (deque<unsigned int>::iterator queued = loadQueue.begin(); queued != loadQueue.end(); ++queued) {
+			requestedPages.erase(*queued);
+		}
+		loadQueue.clear();
+
+		// A page and all its coarser pages are needed: they are what is drawn until it arrives.
+		vector<unsigned int> missing;
+		for (set<unsigned int>::iterator page = needed.begin(); page != needed.end(); ++page) {
+			int x = pageX(*page), y = pageY(*page);
+			for (int level = pageLevel(*page); level < header.levelCount; level++, x /= 2, y /= 2) {
+				unsigned int key = pageKey(x, y, level);
+				map<unsigned int, int>::iterator resident = residentPages.find(key);
+				if (resident != residentPages.end()) {
+					slots[resident->second].lastUsed = frame;
+				} else if (requestedPages.insert(key).second) {
+					missing.push_back(key);
+				}
+			}
+		}
+
+		// Coarse pages first: each one improves a larger part of the picture.
+		sort(missing.begin(), missing.end(), greater<unsigned int>());
+		loadQueue.assign(missing.begin(), missing.end());
+		loaderWake.notify_one();
+	}
+
+	//------------------------------------------------
+	// A free slot, or the least recently used one that the current frame does not need.
+	int findSlot() const {
+		int best = -1;
+		for (unsigned int i = 0; i < slots.size(); i++) {
+			if (slots[i].page == NO_PAGE) {
+				return i;
+			}
+			if (!slots[i].locked && slots[i].lastUsed < frame && (best < 0 || slots[i].lastUsed < slots[best].lastUsed)) {
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	//------------------------------------------------
+	void placePage(unsigned int key, const vector<unsigned char>& texels) {
+		int slot = findSlot();
+		if (slot < 0) {
+			return; // the cache is full of pages this frame needs; asked for again next frame
+		}
+		unsigned int evicted = slots[slot].page;
+		if (evicted != NO_PAGE) {
+			residentPages.erase(evicted);
+			evictionCount++;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, cacheTexture.id());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % cacheSlots) * VIRTUAL_SLOT_SIZE, (slot / cacheSlots) * VIRTUAL_SLOT_SIZE,
+			VIRTUAL_SLOT_SIZE, VIRTUAL_SLOT_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, &texels[0]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		uploadCount++;
+
+		slots[slot].page = key;
+		slots[slot].lastUsed = frame;
+		residentPages[key] = slot;
+
+		if (evicted != NO_PAGE) {
+			refreshIndirection(evicted);
+		}
+		refreshIndirection(key);
+	}
+
+	//------------------------------------------------
+	// Point the indirection entries of a page, and of all the finer pages inside it, at the
+	// nearest resident page.
+	void refreshIndirection(unsigned int key) {
+		for (int level = pageLevel(key); level >= 0; level--) {
+			int scale = 1 << (pageLevel(key) - level);
+			int endX = min((pageX(key) + 1) * scale, virtualPagesX(header, level));
+			int endY = min((pageY(key) + 1) * scale, virtualPagesY(header, level));
+			for (int y = pageY(key) * scale; y < endY; y++) {
+				for (int x = pageX(key) * scale; x < endX; x++) {
+					int residentX = x, residentY = y, residentLevel = level;
+					map<unsigned int, int>::iterator resident = residentPages.find(pageKey(x, y, level));
+					while (resident == residentPages.end()) {
+						residentX /= 2;
+						residentY /= 2;
+						residentLevel++;
+						resident = residentPages.find(pageKey(residentX, residentY, residentLevel));
+					}
+					unsigned char* entry = &indirection[level][4 * (y * virtualPagesX(header, level) + x)];
+					entry[0] = (unsigned char)(resident->second % cacheSlots);
+					entry[1] = (unsigned char)(resident->second / cacheSlots);
+					entry[2] = (unsigned char)residentLevel;
+					entry[3] = 255;
+				}
+			}
+			dirtyLevels[level] = true;
+		}
+	}
+
+	//------------------------------------------------
+	void uploadIndirection() {
+		glBindTexture(GL_TEXTURE_2D, indirectionTexture.id());
+		for (int l = 0; l < header.levelCount; l++) {
+			if (dirtyLevels[l]) {
+				glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, virtualPagesX(header, l), virtualPagesY(header, l),
+					GL_RGBA, GL_UNSIGNED_BYTE, &indirection[l][0]);
+				dirtyLevels[l] = false;
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	//------------------------------------------------
+	void createFeedbackTarget(int width, int height) {
+		feedbackWidth = width;
+		feedbackHeight = height;
+		feedbackFrames = 0;
+
+		GLuint textureIDs[2];
+		glGenTextures(2, textureIDs);
+		glBindTexture(GL_TEXTURE_2D, textureIDs[0]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, textureIDs[1]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		feedbackColor = GpuTexture(GL_TEXTURE_2D, textureIDs[0]);
+		feedbackDepth = GpuTexture(GL_TEXTURE_2D, textureIDs[1]);
+
+		feedbackFramebuffer = GpuFramebuffer(true);
+		glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer.id());
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor.id(), 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, feedbackDepth.id(), 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			cout << "The virtual texture feedback framebuffer is incomplete" << endl;
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		for (int b = 0; b < 2; b++) {
+			feedbackBuffers[b] = GpuBuffer(GPU_PIXEL_BUFFER);
+			feedbackBuffers[b].upload(GL_PIXEL_PACK_BUFFER, 4 * width * height, NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	FILE* file; // read by the loader thread once it runs
+	string fileName;
+	VirtualTextureHeader header;
+
+	GpuTexture cacheTexture;
+	GpuTexture indirectionTexture;
+	int cacheSlots; // per side
+	vector<Slot> slots;
+	map<unsigned int, int> residentPages; // page key -> slot
+	set<unsigned int> requestedPages; // queued, being read, or read and waiting for update()
+	vector<vector<unsigned char> > indirection; // RGBA8 entries of each level
+	vector<bool> dirtyLevels;
+
+	// Shared with the loader thread
+	thread loader;
+	mutex loaderMutex;
+	condition_variable loaderWake;
+	bool running;
+	deque<unsigned int> loadQueue;
+	deque<LoadedPage> loadedPages;
+
+	unsigned int frame;
+	GpuFramebuffer feedbackFramebuffer;
+	GpuTexture feedbackColor;
+	GpuTexture feedbackDepth;
+	GpuBuffer feedbackBuffers[2];
+	int feedbackWidth;
+	int feedbackHeight;
+	int feedbackFrames;
+	GLint savedViewport[4];
+	GLfloat savedClearColor[4];
+
+	unsigned int uploadCount;
+	unsigned int evictionCount;
+};